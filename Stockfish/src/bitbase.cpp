@@ -17,6 +17,7 @@
 */
 
 #include <cassert>
+#include <mutex>
 #include <vector>
 #include <bitset>
 
@@ -30,6 +31,7 @@ namespace {
   constexpr unsigned MAX_INDEX = 2*24*64*64; // stm * psq * wksq * bksq = 196608
 
   std::bitset<MAX_INDEX> KPKBitbase;
+  std::once_flag KPKBuilt;
 
   // A KPK bitbase index is an integer in [0, IndexMax] range
   //
@@ -64,37 +66,56 @@ namespace {
     Result result;
   };
 
+  void build();
+
 } // namespace
 
 
+/// Bitbases::probe() builds the bitbase on first use, most games never reach
+/// KPK and the retrograde analysis is the bulk of the startup time.
+
 bool Bitbases::probe(Square wksq, Square wpsq, Square bksq, Color stm) {
 
   assert(file_of(wpsq) <= FILE_D);
 
+  std::call_once(KPKBuilt, build);
   return KPKBitbase[index(stm, bksq, wksq, wpsq)];
 }
 
 
+/// Bitbases::init() builds the bitbase now rather than on the first probe
+
 void Bitbases::init() {
 
-  std::vector<KPKPosition> db(MAX_INDEX);
-  unsigned idx, repeat = 1;
+  std::call_once(KPKBuilt, build);
+}
 
-  // Initialize db with known win / draw positions
-  for (idx = 0; idx < MAX_INDEX; ++idx)
-      db[idx] = KPKPosition(idx);
 
-  // Iterate through the positions until none of the unknown positions can be
-  // changed to either wins or draws (15 cycles needed).
-  while (repeat)
-      for (repeat = idx = 0; idx < MAX_INDEX; ++idx)
-          repeat |= (db[idx] == UNKNOWN && db[idx].classify(db) != UNKNOWN);
+namespace {
 
-  // Fill the bitbase with the decisive results
-  for (idx = 0; idx < MAX_INDEX; ++idx)
-      if (db[idx] == WIN)
-          KPKBitbase.set(idx);
-}
+  // Classifies every KPK position by retrograde analysis
+  void build() {
+
+    std::vector<KPKPosition> db(MAX_INDEX);
+    unsigned idx, repeat = 1;
+
+    // Initialize db with known win / draw positions
+    for (idx = 0; idx < MAX_INDEX; ++idx)
+        db[idx] = KPKPosition(idx);
+
+    // Iterate through the positions until none of the unknown positions can be
+    // changed to either wins or draws (15 cycles needed).
+    while (repeat)
+        for (repeat = idx = 0; idx < MAX_INDEX; ++idx)
+            repeat |= (db[idx] == UNKNOWN && db[idx].classify(db) != UNKNOWN);
+
+    // Fill the bitbase with the decisive results
+    for (idx = 0; idx < MAX_INDEX; ++idx)
+        if (db[idx] == WIN)
+            KPKBitbase.set(idx);
+  }
+
+} // namespace
 
 
 namespace {
@@ -22,6 +22,10 @@
 #include "bitboard.h"
 #include "misc.h"
 
+// With BITBOARD_TABLES the tables below are defined, already filled in, by
+// bitboard_tables.cpp, generated at build time from this file's init().
+#if !defined(BITBOARD_TABLES)
+
 uint8_t PopCnt16[1 << 16];
 uint8_t SquareDistance[SQUARE_NB][SQUARE_NB];
 
@@ -42,6 +46,8 @@ namespace {
 
 }
 
+#endif
+
 
 /// safe_destination() returns the bitboard of target square for the given step
 /// from the given square. If the step is off the board, returns empty bitboard.
@@ -77,6 +83,7 @@ const std::string Bitboards::pretty(Bitboard b) {
 
 void Bitboards::init() {
 
+#if !defined(BITBOARD_TABLES)
   for (unsigned i = 0; i < (1 << 16); ++i)
       PopCnt16[i] = uint8_t(std::bitset<16>(i).count());
 
@@ -109,9 +116,11 @@ void Bitboards::init() {
               if (PseudoAttacks[pt][s1] & s2)
                   LineBB[s1][s2] = (attacks_bb(pt, s1, 0) & attacks_bb(pt, s2, 0)) | s1 | s2;
   }
+#endif
 }
 
 
+#if !defined(BITBOARD_TABLES)
 namespace {
 
   Bitboard sliding_attack(PieceType pt, Square sq, Bitboard occupied) {
@@ -211,3 +220,4 @@ namespace {
     }
   }
 }
+#endif
@@ -70,7 +70,11 @@ namespace Eval {
 
   void NNUE::init() {
 
+#if defined(NNUE_OFF)
+    useNNUE = false; // No accumulator in StateInfo, nothing to load into
+#else
     useNNUE = Options["Use NNUE"];
+#endif
     if (!useNNUE)
         return;
 
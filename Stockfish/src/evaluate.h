@@ -41,6 +41,7 @@ namespace Eval {
   namespace NNUE {
 
     Value evaluate(const Position& pos);
+    void update_accumulator(const Position& pos);
     bool load_eval(std::string name, std::istream& stream);
     void init();
     void verify();
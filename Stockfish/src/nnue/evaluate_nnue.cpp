@@ -27,6 +27,8 @@
 #include "../uci.h"
 #include "../types.h"
 
+#if !defined(NNUE_OFF)
+
 #include "evaluate_nnue.h"
 
 namespace Eval::NNUE {
@@ -103,6 +105,13 @@ namespace Eval::NNUE {
     return stream && stream.peek() == std::ios::traits_type::eof();
   }
 
+  // Update the accumulator without running the network, so that positions
+  // searched from this one can be evaluated with a differential update.
+  void update_accumulator(const Position& pos) {
+
+    feature_transformer->UpdateAccumulators(pos);
+  }
+
   // Evaluation function. Perform differential calculation.
   Value evaluate(const Position& pos) {
 
@@ -142,3 +151,19 @@ namespace Eval::NNUE {
   }
 
 } // namespace Eval::NNUE
+
+#else
+
+namespace Eval::NNUE {
+
+  // Built without NNUE state in StateInfo: no network can be loaded and
+  // NNUE::init() keeps useNNUE off, so these are never reached.
+  Value evaluate(const Position&) { return VALUE_ZERO; }
+
+  void update_accumulator(const Position&) {}
+
+  bool load_eval(std::string, std::istream&) { return false; }
+
+} // namespace Eval::NNUE
+
+#endif // #if !defined(NNUE_OFF)
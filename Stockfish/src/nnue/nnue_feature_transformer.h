@@ -119,6 +119,13 @@ namespace Eval::NNUE {
       return !stream.fail();
     }
 
+    // Bring both accumulators of the current position up to date
+    void UpdateAccumulators(const Position& pos) const {
+
+      UpdateAccumulator(pos, WHITE);
+      UpdateAccumulator(pos, BLACK);
+    }
+
     // Convert input features
     void Transform(const Position& pos, OutputType* output) const {
 
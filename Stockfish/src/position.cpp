@@ -280,8 +280,10 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Th
   chess960 = isChess960;
   thisThread = th;
   set_state(st);
+#if !defined(NNUE_OFF)
   st->accumulator.state[WHITE] = Eval::NNUE::INIT;
   st->accumulator.state[BLACK] = Eval::NNUE::INIT;
+#endif
 
   assert(pos_is_ok());
 
@@ -706,9 +708,13 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
   ++st->pliesFromNull;
 
   // Used by NNUE
+#if defined(NNUE_OFF)
+  DirtyPiece dp; // Dead stores, the slim StateInfo has nowhere to keep it
+#else
   st->accumulator.state[WHITE] = Eval::NNUE::EMPTY;
   st->accumulator.state[BLACK] = Eval::NNUE::EMPTY;
   auto& dp = st->dirtyPiece;
+#endif
   dp.dirty_num = 1;
 
   Color us = sideToMove;
@@ -971,6 +977,7 @@ void Position::do_castling(Color us, Square from, Square& to, Square& rfrom, Squ
   rto = relative_square(us, kingSide ? SQ_F1 : SQ_D1);
   to = relative_square(us, kingSide ? SQ_G1 : SQ_C1);
 
+#if !defined(NNUE_OFF)
   if (Do && Eval::useNNUE)
   {
       auto& dp = st->dirtyPiece;
@@ -982,6 +989,7 @@ void Position::do_castling(Color us, Square from, Square& to, Square& rfrom, Squ
       dp.to[1] = rto;
       dp.dirty_num = 2;
   }
+#endif
 
   // Remove both pieces first since squares could overlap in Chess960
   remove_piece(Do ? from : to);
@@ -1000,15 +1008,21 @@ void Position::do_null_move(StateInfo& newSt) {
   assert(!checkers());
   assert(&newSt != st);
 
+#if defined(NNUE_OFF)
+  std::memcpy(&newSt, st, sizeof(StateInfo));
+#else
   std::memcpy(&newSt, st, offsetof(StateInfo, accumulator));
+#endif
 
   newSt.previous = st;
   st = &newSt;
 
+#if !defined(NNUE_OFF)
   st->dirtyPiece.dirty_num = 0;
   st->dirtyPiece.piece[0] = NO_PIECE; // Avoid checks in UpdateAccumulator()
   st->accumulator.state[WHITE] = Eval::NNUE::EMPTY;
   st->accumulator.state[BLACK] = Eval::NNUE::EMPTY;
+#endif
 
   if (st->epSquare != SQ_NONE)
   {
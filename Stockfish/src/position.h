@@ -34,31 +34,35 @@
 /// StateInfo struct stores information needed to restore a Position object to
 /// its previous state when we retract a move. Whenever a move is made on the
 /// board (by calling Position::do_move), a StateInfo object must be passed.
+/// Builds with NNUE_OFF drop the NNUE state, which is most of the struct.
 
 struct StateInfo {
 
   // Copied when making a move
-  Key    pawnKey;
-  Key    materialKey;
-  Value  nonPawnMaterial[COLOR_NB];
-  int    castlingRights;
-  int    rule50;
-  int    pliesFromNull;
-  Square epSquare;
-
-  // Not copied when making a move (will be recomputed anyhow)
-  Key        key;
-  Bitboard   checkersBB;
-  Piece      capturedPiece;
-  StateInfo* previous;
-  Bitboard   blockersForKing[COLOR_NB];
-  Bitboard   pinners[COLOR_NB];
-  Bitboard   checkSquares[PIECE_TYPE_NB];
-  int        repetition;
-
+  Key          pawnKey;
+  Key          materialKey;
+  Value        nonPawnMaterial[COLOR_NB];
+  Square       epSquare;
+  std::int16_t rule50;
+  std::int16_t pliesFromNull;
+  std::uint8_t castlingRights;
+
+  // Not copied when making a move (will be recomputed anyhow). Ordered by
+  // use: do_move() and legal()/gives_check() first, repetition checks last.
+  Key          key;
+  Bitboard     checkersBB;
+  StateInfo*   previous;
+  Bitboard     blockersForKing[COLOR_NB];
+  Bitboard     pinners[COLOR_NB];
+  Bitboard     checkSquares[PIECE_TYPE_NB];
+  Piece        capturedPiece;
+  std::int16_t repetition;
+
+#if !defined(NNUE_OFF)
   // Used by NNUE
   Eval::NNUE::Accumulator accumulator;
   DirtyPiece dirtyPiece;
+#endif
 };
 
 
@@ -156,6 +160,7 @@ public:
   int game_ply() const;
   bool is_chess960() const;
   Thread* this_thread() const;
+  void set_thread(Thread* th);
   bool is_draw(int ply) const;
   bool has_game_cycle(int ply) const;
   bool has_repeated() const;
@@ -184,19 +189,21 @@ private:
   template<bool Do>
   void do_castling(Color us, Square from, Square& to, Square& rfrom, Square& rto);
 
-  // Data members
-  Piece board[SQUARE_NB];
+  // Data members. Everything do_move(), legal() and attackers_to() read is
+  // packed into the first three cache lines, the castling tables after it
+  // are only consulted for moves that touch a castling square.
   Bitboard byTypeBB[PIECE_TYPE_NB];
   Bitboard byColorBB[COLOR_NB];
-  int pieceCount[PIECE_NB];
-  int castlingRightsMask[SQUARE_NB];
-  Square castlingRookSquare[CASTLING_RIGHT_NB];
-  Bitboard castlingPath[CASTLING_RIGHT_NB];
+  StateInfo* st;
+  Thread* thisThread;
+  Score psq;
   int gamePly;
   Color sideToMove;
-  Score psq;
-  Thread* thisThread;
-  StateInfo* st;
+  std::int8_t pieceCount[PIECE_NB];
+  Piece board[SQUARE_NB];
+  std::uint8_t castlingRightsMask[SQUARE_NB];
+  Square castlingRookSquare[CASTLING_RIGHT_NB];
+  Bitboard castlingPath[CASTLING_RIGHT_NB];
   bool chess960;
 };
 
@@ -382,6 +389,11 @@ inline Thread* Position::this_thread() const {
   return thisThread;
 }
 
+// Hands the position to another thread (its eval tables and node counter)
+inline void Position::set_thread(Thread* th) {
+  thisThread = th;
+}
+
 inline void Position::put_piece(Piece pc, Square s) {
 
   board[s] = pc;
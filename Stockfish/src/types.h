@@ -200,7 +200,7 @@ enum PieceType {
   PIECE_TYPE_NB = 8
 };
 
-enum Piece {
+enum Piece : std::int8_t {
   NO_PIECE,
   W_PAWN = PAWN,     W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
   B_PAWN = PAWN + 8, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING,
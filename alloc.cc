@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+#include "alloc.h"
+
+namespace alloc_stats {
+
+namespace {
+
+constexpr int MAX_SITES = 64;
+
+// site 0 is everything outside an ALLOC_SITE scope
+std::atomic<int> g_sites{1};
+const char *g_names[MAX_SITES] = {"other"};
+std::atomic<size_t> g_allocations[MAX_SITES];
+std::atomic<size_t> g_bytes[MAX_SITES];
+
+// plain int, so touching it from operator new needs no TLS initialization
+thread_local int g_site = 0;
+
+} // namespace
+
+#if defined(BRMBOT_ALLOC_STATS)
+
+bool enabled() { return true; }
+
+void count(size_t bytes) {
+  g_allocations[g_site].fetch_add(1, std::memory_order_relaxed);
+  g_bytes[g_site].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+#else
+
+bool enabled() { return false; }
+
+#endif
+
+int site(const char *name) {
+  const int id = g_sites++;
+  if (id >= MAX_SITES) {
+    return 0;
+  }
+  g_names[id] = name;
+  return id;
+}
+
+Scope::Scope(int site) : previous_(g_site) { g_site = site; }
+Scope::~Scope() { g_site = previous_; }
+
+void reset() {
+  for (int i = 0; i < MAX_SITES; ++i) {
+    g_allocations[i] = 0;
+    g_bytes[i] = 0;
+  }
+}
+
+Counts total() {
+  Counts c{0, 0};
+  for (int i = 0; i < MAX_SITES; ++i) {
+    c.allocations += g_allocations[i];
+    c.bytes += g_bytes[i];
+  }
+  return c;
+}
+
+void print(std::ostream &os, size_t searches, size_t nodes) {
+  const int sites = std::min<int>(g_sites, MAX_SITES);
+  os << "Allocations     : " << total().allocations << " (" << total().bytes
+     << " bytes)\n";
+  os << std::setprecision(3);
+  for (int i = 0; i < sites; ++i) {
+    const size_t n = g_allocations[i], bytes = g_bytes[i];
+    if (!n) {
+      continue;
+    }
+    os << "  " << std::left << std::setw(14) << g_names[i] << std::right
+       << n << " allocs, " << bytes << " bytes, "
+       << double(n) / std::max<size_t>(searches, 1) << "/search, "
+       << double(n) / std::max<size_t>(nodes, 1) << "/node\n";
+  }
+  os << std::defaultfloat;
+}
+
+} // namespace alloc_stats
+
+#if defined(BRMBOT_ALLOC_STATS)
+
+// Replacements for every form of the global operator new/delete.  Builds use
+// -fno-exceptions, so running out of memory aborts, except in the nothrow
+// forms, which return nullptr as they have to.
+
+namespace {
+
+void *try_allocate(size_t n) {
+  alloc_stats::count(n);
+  return std::malloc(n ? n : 1);
+}
+
+void *try_allocate(size_t n, std::align_val_t al) {
+  alloc_stats::count(n);
+  const auto a = static_cast<size_t>(al);
+  // aligned_alloc wants a multiple of the alignment
+  return std::aligned_alloc(a, (std::max<size_t>(n, 1) + a - 1) / a * a);
+}
+
+template <typename... Args> void *allocate(size_t n, Args... args) {
+  void *p = try_allocate(n, args...);
+  if (!p) {
+    std::abort();
+  }
+  return p;
+}
+
+} // namespace
+
+void *operator new(size_t n) { return allocate(n); }
+void *operator new[](size_t n) { return allocate(n); }
+void *operator new(size_t n, const std::nothrow_t &) noexcept {
+  return try_allocate(n);
+}
+void *operator new[](size_t n, const std::nothrow_t &) noexcept {
+  return try_allocate(n);
+}
+void *operator new(size_t n, std::align_val_t al) { return allocate(n, al); }
+void *operator new[](size_t n, std::align_val_t al) {
+  return allocate(n, al);
+}
+void *operator new(size_t n, std::align_val_t al,
+                   const std::nothrow_t &) noexcept {
+  return try_allocate(n, al);
+}
+void *operator new[](size_t n, std::align_val_t al,
+                     const std::nothrow_t &) noexcept {
+  return try_allocate(n, al);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+// Heap allocation accounting through the replaceable global operator new,
+// compiled in with -DALLOC_STATS=ON (BRMBOT_ALLOC_STATS).  Each allocation is
+// charged to the innermost ALLOC_SITE scope of the allocating thread, or to
+// "other" outside of any.
+namespace alloc_stats {
+
+struct Counts {
+  size_t allocations;
+  size_t bytes;
+};
+
+bool enabled();
+void reset();
+Counts total();
+
+// per site table, with averages over the given searches and nodes
+void print(std::ostream &os, size_t searches, size_t nodes);
+
+// registers a site name, the returned id is used by Scope
+int site(const char *name);
+
+class Scope {
+public:
+  explicit Scope(int site);
+  ~Scope();
+
+private:
+  int previous_;
+};
+
+} // namespace alloc_stats
+
+#if defined(BRMBOT_ALLOC_STATS)
+#define ALLOC_SITE(name)                                                       \
+  static const int alloc_site_ = alloc_stats::site(name);                      \
+  alloc_stats::Scope alloc_scope_(alloc_site_)
+#else
+#define ALLOC_SITE(name)
+#endif
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+#include "alloc.h"
+#include "bench.h"
+#include "engine.h"
+#include "perf_counters.h"
+#include "thread.h"
+#include "uci.h"
+
+extern std::vector<std::string> setup_bench(const Position &, std::istream &);
+
+std::vector<BenchPosition> bench_positions() {
+  std::vector<BenchPosition> positions;
+  Position current;
+  StateInfo si;
+  current.set(START_POS, false, &si, Threads.main());
+  std::istringstream args("16 1 1 default depth");
+  bool chess960 = false;
+  for (const auto &cmd : setup_bench(current, args)) {
+    std::istringstream is(cmd);
+    std::string token;
+    is >> token;
+    if (token == "setoption" && cmd.find("UCI_Chess960") != std::string::npos) {
+      chess960 = cmd.find("value true") != std::string::npos;
+    } else if (token == "position") {
+      BenchPosition b{"", {}, chess960};
+      is >> token; // fen
+      while (is >> token && token != "moves") {
+        b.fen += (b.fen.empty() ? "" : " ") + token;
+      }
+      while (is >> token) {
+        b.moves.emplace_back(token);
+      }
+      positions.emplace_back(b);
+    }
+  }
+  return positions;
+}
+
+void setup(Position &p, StateListPtr &states, const BenchPosition &b,
+           Thread *th) {
+  ALLOC_SITE("setup");
+  states = StateListPtr(new std::deque<StateInfo>(1));
+  p.set(b.fen, b.chess960, &states->back(), th);
+  for (auto m : b.moves) {
+    states->emplace_back();
+    p.do_move(UCI::to_move(p, m), states->back());
+  }
+}
+
+namespace {
+
+void print_counters(std::ostream &os, const PerfCounters::Values &v,
+                    size_t nodes) {
+  os << std::fixed << std::setprecision(2);
+  if (v[PerfCounters::CYCLES] > 0 && v[PerfCounters::INSTRUCTIONS] >= 0) {
+    os << " ipc " << v[PerfCounters::INSTRUCTIONS] / v[PerfCounters::CYCLES];
+  }
+  for (auto e : {PerfCounters::CYCLES, PerfCounters::L1D_MISSES,
+                 PerfCounters::LLC_MISSES, PerfCounters::BRANCH_MISSES}) {
+    if (v[e] >= 0 && nodes) {
+      os << " " << PerfCounters::name(e) << "/node " << v[e] / nodes;
+    }
+  }
+  os << std::defaultfloat;
+}
+
+} // namespace
+
+BenchResult run_bench(const std::vector<BenchPosition> &positions, int depth,
+                      int threads, bool counters) {
+  // stockfish threads are only used for their per thread eval tables
+  threads = std::max(threads, 1);
+  Threads.set(threads);
+  BenchResult r;
+  r.moves.resize(positions.size());
+  r.nodes.resize(positions.size());
+  r.times.resize(positions.size());
+  r.counters.resize(positions.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&](Thread *th) {
+    // counters follow the thread that opened them
+    std::optional<PerfCounters> pmu;
+    if (counters) {
+      pmu.emplace();
+    }
+    for (size_t i; (i = next++) < positions.size();) {
+      Position p;
+      StateListPtr states;
+      setup(p, states, positions[i], th);
+      auto start = std::chrono::steady_clock::now();
+      if (pmu) {
+        pmu->start();
+      }
+      std::tie(r.moves[i], r.nodes[i]) =
+          best_move(p, std::numeric_limits<double>::infinity(), depth);
+      if (pmu) {
+        r.counters[i] = pmu->stop();
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      r.times[i] = elapsed.count();
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (auto t = 0; t < threads; ++t) {
+    workers.emplace_back(worker, Threads[t]);
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  r.elapsed = elapsed.count();
+  return r;
+}
+
+size_t BenchResult::total_nodes() const {
+  return std::accumulate(nodes.begin(), nodes.end(), size_t(0));
+}
+
+// With one thread the total node count is a deterministic signature of the
+// search, with more the positions are split across threads sharing the cache.
+void bench(int depth, int threads, bool counters) {
+  const auto positions = bench_positions();
+  alloc_stats::reset();
+  const auto r = run_bench(positions, depth, threads, counters);
+  const auto &hw = r.counters;
+
+  PerfCounters::Values hw_total{};
+  for (size_t i = 0; i < positions.size(); ++i) {
+    std::cerr << "Position: " << i + 1 << '/' << positions.size() << " ("
+              << positions[i].fen << ") "
+              << UCI::move(r.moves[i], positions[i].chess960) << " "
+              << r.nodes[i];
+    if (counters) {
+      print_counters(std::cerr, hw[i], r.nodes[i]);
+      for (int e = 0; e < PerfCounters::EVENT_NB; ++e) {
+        // stays negative (unavailable) if any position missed the event
+        hw_total[e] =
+            hw[i][e] < 0 || hw_total[e] < 0 ? -1 : hw_total[e] + hw[i][e];
+      }
+    }
+    std::cerr << "\n";
+  }
+  const auto total = r.total_nodes();
+  std::cerr << "\n==========================="
+            << "\nTotal time (ms) : " << size_t(r.elapsed * 1000)
+            << "\nNodes searched  : " << total
+            << "\nNodes/second    : " << size_t(r.nps());
+  if (counters) {
+    std::cerr << "\nCounters        :";
+    print_counters(std::cerr, hw_total, total);
+  }
+  std::cerr << std::endl;
+  if (alloc_stats::enabled()) {
+    alloc_stats::print(std::cerr, positions.size(), total);
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+#include "position.h"
+
+class Thread;
+
+// A position from stockfish's bench list, moves are applied after the FEN
+struct BenchPosition {
+  std::string fen;
+  std::vector<std::string> moves;
+  bool chess960;
+};
+
+std::vector<BenchPosition> bench_positions();
+
+// sets up p from b, states keeps the history alive
+void setup(Position &p, StateListPtr &states, const BenchPosition &b,
+           Thread *th);
+
+struct BenchResult {
+  std::vector<Move> moves;
+  std::vector<size_t> nodes;
+  std::vector<double> times; // seconds per position
+  std::vector<PerfCounters::Values> counters;
+  double elapsed; // wall time of the whole run
+
+  size_t total_nodes() const;
+  double nps() const { return total_nodes() / elapsed; }
+};
+
+// one pass over positions, optionally sampling hardware counters
+BenchResult run_bench(const std::vector<BenchPosition> &positions, int depth,
+                      int threads, bool counters = false);
+
+// Searches the bench positions to a fixed depth with no time limit and
+// prints nodes, time and NPS.  With counters, hardware counters are sampled
+// around every position and reported as IPC and misses per node.
+void bench(int depth, int threads, bool counters = false);
+
+// Runs the bench runs times (with a cleared cache each time) and writes NPS,
+// nodes and per position times to path
+void bench_save(const std::string &path, int depth, int threads, int runs);
+
+// Runs the bench like bench_save and compares against the baseline in path
+// with 95% confidence intervals.  Returns false on a significant slowdown.
+bool bench_compare(const std::string &path, int threads, int runs);
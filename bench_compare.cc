@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "bench.h"
+#include "engine.h"
+
+namespace {
+
+struct Run {
+  size_t nodes;
+  double elapsed;
+  std::vector<double> times;
+
+  double nps() const { return nodes / elapsed; }
+};
+
+struct Baseline {
+  int depth = 0;
+  int threads = 0;
+  std::vector<Run> runs;
+};
+
+std::vector<Run> run(const std::vector<BenchPosition> &positions, int depth,
+                     int threads, int runs) {
+  std::vector<Run> out;
+  for (int i = 0; i < runs; ++i) {
+    // every run starts cold so the node counts stay comparable
+    clear_cache();
+    const auto r = run_bench(positions, depth, threads);
+    out.push_back({r.total_nodes(), r.elapsed, r.times});
+    std::cerr << "run " << i + 1 << "/" << runs << ": " << size_t(r.nps())
+              << " nps\n";
+  }
+  return out;
+}
+
+bool read_baseline(const std::string &path, Baseline &b) {
+  std::ifstream in(path);
+  std::string token;
+  if (!(in >> token) || token != "brmbot-bench") {
+    std::cerr << path << " is not a bench baseline\n";
+    return false;
+  }
+  in >> token >> b.depth >> token >> b.threads;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream is(line);
+    Run r;
+    if (!(is >> token >> r.nodes >> r.elapsed) || token != "run") {
+      continue;
+    }
+    for (double t; is >> t;) {
+      r.times.emplace_back(t);
+    }
+    b.runs.emplace_back(r);
+  }
+  return b.runs.size() > 0;
+}
+
+// 97.5% quantile of Student's t, for two sided 95% intervals
+double t_critical(double df) {
+  static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447,
+                                 2.365,  2.306, 2.262, 2.228, 2.201, 2.179,
+                                 2.160,  2.145, 2.131, 2.120, 2.110, 2.101,
+                                 2.093,  2.086, 2.080, 2.074, 2.069, 2.064,
+                                 2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+  const int n = std::max(1, int(df));
+  return n <= 30 ? table[n - 1] : 1.96;
+}
+
+struct Interval {
+  double diff, low, high; // new - base, relative to the base mean
+};
+
+// Welch's 95% interval for the difference of the means of b and n
+Interval welch(const std::vector<double> &b, const std::vector<double> &n) {
+  auto moments = [](const std::vector<double> &x) {
+    double mean = 0, var = 0;
+    for (auto v : x) {
+      mean += v;
+    }
+    mean /= x.size();
+    for (auto v : x) {
+      var += (v - mean) * (v - mean);
+    }
+    return std::make_pair(mean, x.size() > 1 ? var / (x.size() - 1) : 0.0);
+  };
+  const auto [mb, vb] = moments(b);
+  const auto [mn, vn] = moments(n);
+  const double sb = vb / b.size(), sn = vn / n.size();
+  const double se = std::sqrt(sb + sn);
+  const double df =
+      se > 0 ? (sb + sn) * (sb + sn) /
+                   (sb * sb / std::max<size_t>(b.size() - 1, 1) +
+                    sn * sn / std::max<size_t>(n.size() - 1, 1))
+             : 1;
+  const double h = t_critical(df) * se;
+  return {(mn - mb) / mb, (mn - mb - h) / mb, (mn - mb + h) / mb};
+}
+
+std::ostream &operator<<(std::ostream &os, const Interval &i) {
+  return os << std::showpos << std::fixed << std::setprecision(2)
+            << i.diff * 100 << "% [" << i.low * 100 << "%, " << i.high * 100
+            << "%]" << std::noshowpos << std::defaultfloat;
+}
+
+} // namespace
+
+void bench_save(const std::string &path, int depth, int threads, int runs) {
+  const auto positions = bench_positions();
+  const auto results = run(positions, depth, threads, std::max(runs, 2));
+  std::ofstream out(path);
+  out << "brmbot-bench depth " << depth << " threads " << threads << "\n";
+  for (const auto &r : results) {
+    out << "run " << r.nodes << " " << r.elapsed;
+    for (auto t : r.times) {
+      out << " " << t;
+    }
+    out << "\n";
+  }
+  std::cerr << "saved " << results.size() << " runs to " << path << "\n";
+}
+
+bool bench_compare(const std::string &path, int threads, int runs) {
+  Baseline base;
+  if (!read_baseline(path, base)) {
+    return false;
+  }
+  const auto positions = bench_positions();
+  const auto now = run(positions, base.depth, threads ? threads : base.threads,
+                       std::max(runs, 2));
+
+  auto series = [](const std::vector<Run> &runs, auto f) {
+    std::vector<double> x;
+    for (const auto &r : runs) {
+      x.emplace_back(f(r));
+    }
+    return x;
+  };
+  if (base.runs.front().nodes != now.front().nodes) {
+    std::cout << "nodes differ (" << base.runs.front().nodes << " -> "
+              << now.front().nodes
+              << "), the search changed: compare NPS, not times\n";
+  }
+
+  // a slower position takes more time, a slower binary has fewer NPS
+  std::cout << "position time changes (95% CI):\n";
+  for (size_t i = 0; i < positions.size(); ++i) {
+    if (base.runs.front().times.size() != positions.size()) {
+      std::cout << "  baseline has a different position list\n";
+      break;
+    }
+    auto time_of = [i](const Run &r) { return r.times[i]; };
+    const auto ci = welch(series(base.runs, time_of), series(now, time_of));
+    if (ci.low > 0) {
+      std::cout << "  " << i + 1 << " (" << positions[i].fen << ") slower "
+                << ci << "\n";
+    }
+  }
+
+  const auto nps = welch(series(base.runs, [](const Run &r) { return r.nps(); }),
+                         series(now, [](const Run &r) { return r.nps(); }));
+  const bool slower = nps.high < 0;
+  std::cout << "Nodes/second    : " << nps
+            << (slower ? " SLOWER" : nps.low > 0 ? " faster" : " no change")
+            << std::endl;
+  return !slower;
+}
@@ -0,0 +1,736 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "bitboard.h"
+#include "engine.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "position.h"
+#include "alloc.h"
+#include "stats.h"
+#include "thread.h"
+#include "uci.h"
+
+DEFINE_bool(cache, true, "Enable cache for negamax");
+DEFINE_bool(killers, true, "Enable killer opt for negamax");
+DEFINE_int64(cache_size, 1 << 24, "Set cache size for negamax");
+DEFINE_bool(idfs, true, "Enable iterative depth first search");
+DEFINE_int32(order_buckets, 5, "Number of buckets for fast ordering");
+DEFINE_bool(print_depth, false, "Dump the depth achieved every move");
+DEFINE_bool(print_eval, false, "Dump the evaluation for every move");
+DEFINE_int32(depth, 20, "Maximum depth to search per move");
+DEFINE_string(eval, "brm", "Evaluation backend (brm, classical or nnue)");
+DEFINE_string(eval_file, EvalFileDefaultName, "NNUE network for --eval=nnue");
+DEFINE_bool(print_stats, false, "Dump search statistics (needs -DSTATS=ON)");
+
+std::mt19937 &getRandDevice() {
+  static std::random_device rd;
+  static std::mt19937 g(rd());
+  return g;
+}
+
+int val(const Piece &p) {
+  switch (type_of(p)) {
+  case PAWN:
+    return 100;
+  case KNIGHT:
+    return 300;
+  case BISHOP:
+    return 300;
+  case ROOK:
+    return 500;
+  case QUEEN:
+    return 900;
+  case KING:
+    return 350;
+  default:
+    return 0;
+  }
+  return 0;
+}
+
+// this is expensive
+int center_control(const Position &p, Color c) {
+  auto ps = p.pieces(c);
+  int sum = popcount((p.attackers_to(SQ_D4) | p.attackers_to(SQ_E4) |
+                      p.attackers_to(SQ_D5) | p.attackers_to(SQ_E5)) &
+                     ps);
+  return sum;
+}
+
+int king_safety(const Position &p, Color c) {
+  Square ksq = p.square<KING>(c);
+  int sum = -popcount(p.attackers_to(ksq) & p.pieces(~c));
+  return sum;
+}
+
+int pawn_structure(const Position &p, Color c) {
+  int sum = 0;
+  auto pawns = p.pieces(c, PAWN);
+  if (c == WHITE) {
+    sum = popcount(pawn_attacks_bb<WHITE>(pawns));
+  } else {
+    sum = popcount(pawn_attacks_bb<BLACK>(pawns));
+  }
+
+  return sum;
+}
+
+inline int activity(const Position &p, Color c) {
+  auto ps = p.pieces(c, KNIGHT, BISHOP);
+  if (c == WHITE) {
+    return -popcount(ps & Rank1BB);
+  } else {
+    return -popcount(ps & Rank8BB);
+  }
+}
+
+inline int eval(const Position &p, Color c) {
+  int sum = 0;
+  sum += 100 * p.count<PAWN>(c);
+  if (sum >= 700) {
+    sum += 10 * center_control(p, c);
+    sum += 10 * activity(p, c);
+    sum += 10 * pawn_structure(p, c);
+  }
+  sum += 300 * popcount(p.pieces(c, KNIGHT, BISHOP));
+  sum += 500 * p.count<ROOK>(c);
+  sum += 900 * p.count<QUEEN>(c);
+  sum += 10 * king_safety(p, c);
+  return sum;
+}
+
+// returns 0 on equal value
+int normalized_eval(const Position &p) {
+  return eval(p, p.side_to_move()) - eval(p, ~p.side_to_move());
+}
+
+// --eval, set by init()
+static eval_backend g_eval = BRM_EVAL;
+
+namespace {
+
+// value in the low 32 bits, then depth, flag and a used bit
+constexpr uint64_t ENTRY_USED = 1ULL << 50;
+
+inline uint64_t pack(const Entry &e) {
+  return uint64_t(uint32_t(e.value)) | uint64_t(uint16_t(e.depth)) << 32 |
+         uint64_t(e.flag) << 48 | ENTRY_USED;
+}
+
+} // namespace
+
+Entry Cache::lookup(Key hash) const {
+  const auto &slot = slots_[hash % slots_.size()];
+  const auto data = slot.data.load(std::memory_order_relaxed);
+  const auto check = slot.check.load(std::memory_order_relaxed);
+  Entry entry;
+  entry.hash = hash;
+  entry.valid = (data & ENTRY_USED) && (check ^ data) == hash;
+  entry.value = int32_t(uint32_t(data));
+  entry.depth = int16_t(uint16_t(data >> 32));
+  entry.flag = entry_flag((data >> 48) & 3);
+  return entry;
+}
+
+void Cache::set(Key hash, Entry &e) {
+  auto &slot = slots_[hash % slots_.size()];
+  e.hash = hash;
+  e.valid = true;
+  const auto data = pack(e);
+  slot.check.store(hash ^ data, std::memory_order_relaxed);
+  slot.data.store(data, std::memory_order_relaxed);
+}
+
+void Cache::clear() {
+  for (auto &slot : slots_) {
+    slot.check.store(0, std::memory_order_relaxed);
+    slot.data.store(0, std::memory_order_relaxed);
+  }
+}
+
+int Cache::hashfull() const {
+  const auto n = std::min<size_t>(1000, slots_.size());
+  const auto used =
+      std::count_if(slots_.begin(), slots_.begin() + n, [](const Slot &s) {
+        return s.data.load(std::memory_order_relaxed) & ENTRY_USED;
+      });
+  return n ? used * 1000 / n : 0;
+}
+
+Cache &shared_cache() {
+  static Cache cache(FLAGS_cache_size);
+  return cache;
+}
+
+void clear_cache() { shared_cache().clear(); }
+
+Entry lookup(Key hash) { return shared_cache().lookup(hash); }
+
+Entry lookup(Position &p) { return lookup(p.key()); }
+
+void set(Key hash, Entry &e) { shared_cache().set(hash, e); }
+
+void set(Position &p, Entry &e) { set(p.key(), e); }
+
+SearchOptions SearchOptions::from_flags() {
+  return {FLAGS_cache,         FLAGS_killers,     FLAGS_idfs,
+          FLAGS_depth,         FLAGS_order_buckets, FLAGS_print_depth,
+          FLAGS_print_eval,    FLAGS_print_stats, g_eval};
+}
+
+SearchContext::SearchContext(Cache *cache, const SearchOptions &options)
+    : cache(cache), options(options), pv(new PrincipalVariation()),
+      states(new StateInfo[MAX_PLY + 1]) {
+  clear();
+}
+
+void SearchContext::clear() { memset(killers, 0, sizeof(killers)); }
+
+SearchContext &thread_context() {
+  thread_local SearchContext ctx;
+  return ctx;
+}
+
+std::string print_square(Square s) {
+  std::stringstream ss;
+  ss << char(file_of(s) + 'a') << char(rank_of(s) + '1');
+  return ss.str();
+}
+
+inline int move_val(const Position &p, const Move &m,
+                    const Move (&killer)[KILLERS_PER_PLY]) {
+  if (type_of(m) == PROMOTION) {
+    return 2500;
+  }
+  if (p.gives_check(m)) {
+    return 1500;
+  }
+  if (p.capture(m)) {
+    return 2000;
+  }
+  return 1000;
+}
+
+inline int move_val_old(const Position &p, const Move &m,
+                        const Move (&killer)[KILLERS_PER_PLY]) {
+  for (auto i = 0; i < KILLERS_PER_PLY; ++i) {
+    if (m == killer[i]) {
+      return 2000;
+    }
+  }
+  if (p.gives_check(m)) {
+    return 1800;
+  }
+  switch (type_of(m)) {
+  case PROMOTION:
+    return 1400;
+  case CASTLING:
+  case ENPASSANT:
+    return 1300;
+  default:
+    break;
+  }
+  auto t = type_of(p.moved_piece(m));
+  constexpr int offset = 500;
+  switch (t) {
+  case PAWN:
+    return (p.capture(m) ? offset : 0) + 600;
+  case BISHOP:
+  case KNIGHT:
+    return (p.capture(m) ? offset : 0) + 500;
+  case ROOK:
+    return (p.capture(m) ? offset : 0) + 400;
+  case QUEEN:
+    return (p.capture(m) ? offset : 0) + 300;
+  case KING:
+    return (p.capture(m) ? offset : 0) + 200;
+  default:
+    return (p.capture(m) ? offset : 0) + 100;
+  }
+  return 100;
+}
+
+#define PRIME 439
+
+Ordered ordered_moves(const Position &p) {
+  ALLOC_SITE("ordered_moves");
+  MoveList<LEGAL> list(p);
+  // checks go straight out, captures and the rest are appended after them
+  Ordered out;
+  Move captures[MAX_MOVES], rest[MAX_MOVES];
+  size_t n_captures = 0, n_rest = 0;
+  for (const auto &m : list) {
+    if (p.gives_check(m)) {
+      out.insert(m);
+    } else if (p.capture_or_promotion(m)) {
+      captures[n_captures++] = m;
+    } else {
+      rest[n_rest++] = m;
+    }
+  }
+  out.insert(captures, captures + n_captures);
+  out.insert(rest, rest + n_rest);
+  return out;
+}
+
+Ordered ordered_moves_fast(const SearchContext &ctx, const Position &p) {
+  MoveList<LEGAL> list(p);
+
+  Move killer[KILLERS_PER_PLY] = {Move()};
+  if (ctx.options.killers) {
+    const auto idx = p.game_ply() % KILLERS;
+    memcpy(killer, ctx.killers[idx], sizeof(Move) * KILLERS_PER_PLY);
+  }
+  int vals[MAX_MOVES];
+  const auto &move_ptr = list.begin();
+  const auto N = list.size();
+  int largest_value = 0;
+  int largest_idx = 0;
+  for (auto i = 0; i < N; ++i) {
+    auto v = move_val(p, move_ptr[i], killer);
+    vals[i] = v;
+    if (v > largest_value) {
+      largest_value = v;
+      largest_idx = i;
+    }
+  }
+
+  Ordered ordered;
+
+  // we want to iterate through the list 3 times assigning values
+  const int buckets = ctx.options.order_buckets;
+  const int target = largest_value / buckets;
+  for (auto k = buckets - 1; k >= 0; --k) {
+    for (auto i = 0; i < N; ++i) {
+      const auto idx = (PRIME * i + 1) % N;
+      const int v = vals[idx];
+      if (v > (k * target) && v <= ((k + 1) * target)) {
+        auto m = move_ptr[idx];
+        ordered.insert(m);
+      }
+    }
+  }
+  return ordered;
+}
+
+inline Ordered ordered_moves_slow(const Position &p) {
+  MoveList<LEGAL> list(p);
+
+  Ordered out;
+  std::pair<Move, int> valued[MAX_MOVES];
+  const auto n = list.size();
+  Move killer[KILLERS_PER_PLY] = {Move()};
+  for (size_t i = 0; i < n; ++i) {
+    valued[i] = std::make_pair(list.begin()[i],
+                               move_val(p, list.begin()[i], killer));
+  }
+  // ties are broken by the shuffle, so the sort needs no (allocating)
+  // stable_sort buffer
+  std::shuffle(valued, valued + n, getRandDevice());
+  std::sort(valued, valued + n,
+            [](const std::pair<Move, int> &a, const std::pair<Move, int> &b) {
+              return a.second > b.second;
+            });
+  for (size_t i = 0; i < n; ++i) {
+    out.insert(valued[i].first);
+  }
+  return out;
+}
+
+inline bool is_killer(const SearchContext &ctx, const Position &p,
+                      const Move &m) {
+  const auto &killers = ctx.killers[p.game_ply() % KILLERS];
+  return std::find(killers, killers + KILLERS_PER_PLY, m) !=
+         killers + KILLERS_PER_PLY;
+}
+
+inline void set_killer(SearchContext &ctx, const Position &p, const Move &m) {
+  auto &killers = ctx.killers;
+  if (ctx.options.killers) {
+    bool set = false;
+    const auto idx = p.game_ply() % KILLERS;
+    for (auto i = 0; i < KILLERS_PER_PLY; ++i) {
+      if (killers[idx][i]) {
+        continue;
+      }
+      killers[idx][i] = m;
+      set = true;
+      break;
+    }
+    // no idea why this is better
+    if (!set) {
+      // killers[idx][m % KILLERS_PER_PLY] = m;
+      killers[idx][0] = m;
+    }
+  }
+}
+
+inline void update_pv(PrincipalVariation &pv, int ply, Move m) {
+  pv.moves[ply][0] = m;
+  std::copy(pv.moves[ply + 1], pv.moves[ply + 1] + pv.length[ply + 1],
+            pv.moves[ply] + 1);
+  pv.length[ply] = pv.length[ply + 1] + 1;
+}
+
+int hashfull() { return shared_cache().hashfull(); }
+
+SearchStats &search_stats() { return thread_context().stats; }
+
+// The thread's context is created on first use and reused by every search
+// (and game) run on the thread.
+StateInfo *state_stack() { return thread_context().states.get(); }
+
+// what the search runs on, checked once at every node
+struct Budget {
+  std::chrono::time_point<std::chrono::steady_clock> start;
+  double max_time;
+  size_t max_nodes; // 0 is unlimited
+  size_t visited;
+  bool stopped = false; // set by the first check that failed
+};
+
+// True once the search has to unwind: stopped through the context (UCI
+// stop/quit), out of nodes, or out of time unless we are pondering.  The
+// answer sticks, so code after a subtree can ask the budget whether it was
+// cut short without reading the clock again.
+inline bool search_stopped(const SearchContext &ctx, Budget &b) {
+  if (b.stopped || ctx.stop.load(std::memory_order_relaxed) ||
+      (b.max_nodes && b.visited >= b.max_nodes)) {
+    return b.stopped = true;
+  }
+  std::chrono::duration<double> diff =
+      std::chrono::steady_clock::now() - b.start;
+  b.stopped = diff.count() > b.max_time &&
+              !ctx.ponder.load(std::memory_order_relaxed);
+  return b.stopped;
+}
+
+int mate_moves(int score) {
+  if (std::abs(score) <= BETA / 2) {
+    return 0;
+  }
+  // mate scores decay by 1% per ply from BETA, count the plies back
+  int plies = 1;
+  for (int s = BETA; s > std::abs(score); s = (s * 99) / 100) {
+    plies++;
+  }
+  return score > 0 ? (plies + 1) / 2 : -plies / 2;
+}
+
+// returns value + nodes scanned
+// ss points at the state for the moves made at this node, deeper plies use the
+// following entries of the same stack
+template <typename E>
+std::pair<int, size_t> negamax(SearchContext &ctx, Position &p, StateInfo *ss,
+                               int depth, int alpha, int beta,
+                               Budget &budget) {
+
+  ALLOC_SITE("negamax");
+  if (search_stopped(ctx, budget)) {
+    return std::make_pair(ALPHA, 0);
+  }
+  budget.visited++;
+
+  auto orig_alpha = alpha;
+  const int ply = ss - ctx.states.get();
+  auto &pv = *ctx.pv;
+  pv.length[ply] = 0;
+  pv.seldepth = std::max(pv.seldepth, ply);
+
+  // repetitions are found through the game history behind the root
+  if (p.is_draw(ply)) {
+    return std::make_pair(0, 1);
+  }
+
+  STAT(auto &stats = ctx.stats);
+  if (ctx.options.cache) {
+    auto entry = ctx.cache->lookup(p.key());
+    STAT(++stats.cache_probes);
+    STAT(stats.cache_hits += entry.valid);
+    if (entry.valid && entry.depth >= depth) {
+      switch (entry.flag) {
+      case EXACT:
+        STAT(++stats.cache_cutoffs);
+        return std::make_pair(entry.value, 1);
+      case LOWERBOUND:
+        alpha = std::max(alpha, entry.value);
+      case UPPERBOUND:
+        beta = std::min(beta, entry.value);
+      }
+      if (alpha > beta) {
+        STAT(++stats.cache_cutoffs);
+        return std::make_pair(entry.value, 1);
+      }
+    }
+  }
+
+  auto moves = ordered_moves(p);
+  int val = ALPHA;
+  size_t nodes = 1;
+
+  // first, check for mates
+  if (moves.size() == 0) {
+    if (popcount(p.checkers())) {
+      // checkmate!
+      return std::make_pair(ALPHA, nodes);
+    }
+    // stalemate :/
+    return std::make_pair(0, nodes);
+  }
+
+  if (depth == 0) {
+    STAT(++stats.leaves);
+    return std::make_pair(E::evaluate(p), 1);
+  }
+
+  STAT(++stats.interior);
+  E::enter(p);
+  for (const auto &m : moves) {
+    p.do_move(m, *ss);
+    const auto r =
+        negamax<E>(ctx, p, ss + 1, depth - 1, -beta, -alpha, budget);
+    if (-r.first > alpha) {
+      update_pv(pv, ply, m);
+    }
+    val = std::max(val, -r.first);
+    nodes += r.second;
+    p.undo_move(m);
+    alpha = std::max(alpha, val);
+    if (alpha >= beta) {
+      STAT(++stats.fail_highs);
+      STAT(stats.first_move_fail_highs += (&m == moves.begin()));
+      STAT(stats.killer_fail_highs += is_killer(ctx, p, m));
+      set_killer(ctx, p, m);
+      break;
+    }
+  }
+
+  // a subtree cut short by the clock has no meaningful value, don't cache it
+  if (budget.stopped) {
+    return std::make_pair(ALPHA, 0);
+  }
+
+  if (ctx.options.cache) {
+    Entry entry;
+    entry.value = val;
+    if (val < orig_alpha) {
+      entry.flag = UPPERBOUND;
+    } else if (val > beta) {
+      entry.flag = LOWERBOUND;
+    } else {
+      entry.flag = EXACT;
+    }
+    entry.depth = depth;
+    ctx.cache->set(p.key(), entry);
+  }
+
+  return std::make_pair((val * 99) / 100, nodes);
+}
+
+// returns best move and nodes scanned
+template <typename E>
+std::pair<Move, size_t> best_move(SearchContext &ctx, Position &p,
+                                  const SearchLimits &limits,
+                                  const InfoCallback &info) {
+  auto start = std::chrono::steady_clock::now();
+  Budget budget{start, limits.hard, limits.nodes, 0};
+  auto depth = limits.depth;
+  ALLOC_SITE("best_move");
+  auto moves = ordered_moves(p);
+  // checkmated or stalemated: nothing to search, report the result once
+  if (moves.size() == 0) {
+    const int score = p.checkers() ? ALPHA : 0;
+    if (info) {
+      info({0, 0, score, 0, 0, {}});
+    }
+    return std::make_pair(MOVE_NONE, 0);
+  }
+  if (limits.searchmoves.size()) {
+    Ordered allowed;
+    for (const auto &m : moves) {
+      if (std::find(limits.searchmoves.begin(), limits.searchmoves.end(), m) !=
+          limits.searchmoves.end()) {
+        allowed.insert(m);
+      }
+    }
+    moves = allowed;
+  }
+  // best move of the last completed iteration, or of the first one
+  Move best_calc = MOVE_NONE;
+  int completed_depth = 0;
+  int best_eval = 0;
+  const auto &options = ctx.options;
+  if (depth == -1) {
+    depth = options.depth;
+  }
+  depth = std::min(depth, MAX_PLY);
+  auto init = options.idfs ? 0 : depth - 1;
+  size_t nodes = 0;
+  // recent best move changes, decayed every iteration
+  double instability = 0;
+  // one contiguous stack of states for the whole search, so the parent of
+  // every node searched is live and (for NNUE) already computed
+  StateInfo *states = ctx.states.get();
+  auto &pv = *ctx.pv;
+  STAT(ctx.stats.clear());
+  E::enter(p);
+  for (auto d = init; d < depth; ++d) {
+    STAT(const auto iteration_start = nodes);
+    pv.seldepth = 0;
+    pv.length[0] = 0;
+    Move best = MOVE_NONE;
+    int best_v = ALPHA;
+    int alpha = ALPHA;
+    bool completed = true;
+    for (const Move &m : moves) {
+      if (search_stopped(ctx, budget)) {
+        completed = false;
+        break;
+      }
+      p.do_move(m, states[0]);
+      const auto r = negamax<E>(ctx, p, &states[1], d, alpha, BETA, budget);
+      int val = -r.first;
+      // this negamax did not complete!
+      if (r.second == 0) {
+        val = ALPHA;
+      }
+      // alpha = std::max(alpha, val);
+      nodes += r.second;
+      p.undo_move(m);
+      // std::cerr << "considering " << UCI::move(m, false) << ":" << val <<
+      // "\n";
+      if (val > best_v) {
+        best = m;
+        best_v = val;
+        update_pv(pv, 0, m);
+      }
+    }
+    // the last root move may have been cut short
+    completed = completed && !budget.stopped;
+    // a partial iteration would skew the branching factor
+    STAT(if (completed) {
+      ctx.stats.iteration_nodes.emplace_back(nodes - iteration_start);
+    });
+    if (completed && completed_depth) {
+      instability = instability / 2 + (best != best_calc);
+    }
+    if (completed || completed_depth == 0) {
+      best_calc = best;
+      completed_depth++;
+      best_eval = best_v;
+    }
+    if (completed && info) {
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      info({d + 1, std::max(pv.seldepth, d + 1), best_v, nodes,
+            elapsed.count(),
+            std::vector<Move>(pv.moves[0], pv.moves[0] + pv.length[0])});
+    }
+    if (!completed) {
+      break;
+    }
+    // go mate: done once a short enough mate is found
+    const int mate = mate_moves(best_v);
+    if (limits.mate && mate > 0 && mate <= limits.mate) {
+      break;
+    }
+    // past the soft limit, an unstable best move buys more time
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (elapsed.count() > limits.soft * (1 + instability) && !ctx.ponder) {
+      break;
+    }
+  }
+  // stopped before the first root move finished, any legal move beats none
+  if (best_calc == MOVE_NONE && moves.size()) {
+    best_calc = *moves.begin();
+  }
+  // diagnostics go to stderr, stdout carries the UCI protocol
+#if defined(BRMBOT_STATS)
+  if (options.print_stats) {
+    ctx.stats.print(std::cerr);
+  }
+#endif
+  if (options.print_depth) {
+    std::cerr << "depth:\t" << completed_depth << "\n";
+  }
+  if (options.print_eval) {
+    std::cerr << "eval:\t" << best_eval * (p.side_to_move() == BLACK ? -1 : 1)
+              << "\n";
+  }
+  // clear a new killers spot
+  // memset(killers[(p.game_ply() + 1) % KILLERS], 0, KILLERS_PER_PLY);
+  return std::make_pair(best_calc, nodes);
+}
+
+template std::pair<Move, size_t>
+best_move<BrmEval>(SearchContext &, Position &, const SearchLimits &,
+                   const InfoCallback &);
+template std::pair<Move, size_t>
+best_move<ClassicalEval>(SearchContext &, Position &, const SearchLimits &,
+                         const InfoCallback &);
+template std::pair<Move, size_t>
+best_move<NNUEEval>(SearchContext &, Position &, const SearchLimits &,
+                    const InfoCallback &);
+
+std::pair<Move, size_t> best_move(SearchContext &ctx, Position &p,
+                                  const SearchLimits &limits,
+                                  const InfoCallback &info) {
+  switch (ctx.options.eval) {
+  case CLASSICAL_EVAL:
+    return best_move<ClassicalEval>(ctx, p, limits, info);
+  case NNUE_EVAL:
+    return best_move<NNUEEval>(ctx, p, limits, info);
+  default:
+    return best_move<BrmEval>(ctx, p, limits, info);
+  }
+}
+
+std::pair<Move, size_t> best_move(Position &p, const SearchLimits &limits,
+                                  const InfoCallback &info) {
+  return best_move(thread_context(), p, limits, info);
+}
+
+std::pair<Move, size_t> best_move(Position &p, double max_time, int32_t depth,
+                                  const InfoCallback &info) {
+  SearchLimits limits;
+  limits.soft = limits.hard = max_time;
+  limits.depth = depth;
+  return best_move(p, limits, info);
+}
+
+void init() {
+  UCI::init(Options);
+  Bitboards::init();
+  Position::init();
+  // the KPK bitbase is built on its first probe (classical eval only)
+  Threads.set(1);
+  // allocate the cache up front so the first search doesn't pay for it
+  shared_cache();
+#if !defined(BRMBOT_STATS)
+  if (FLAGS_print_stats) {
+    std::cerr << "brmbot was built without -DSTATS=ON, --print_stats is a no-op\n";
+  }
+#endif
+
+  if (FLAGS_eval == "classical") {
+    g_eval = CLASSICAL_EVAL;
+  } else if (FLAGS_eval == "nnue") {
+#if defined(NNUE_OFF)
+    std::cerr << "brmbot was built with -DNNUE=OFF, --eval=nnue is unavailable\n";
+    exit(1);
+#endif
+    g_eval = NNUE_EVAL;
+    // triggers Eval::NNUE::init(), verify() exits if the net didn't load
+    Options["EvalFile"] = FLAGS_eval_file;
+    Eval::NNUE::verify();
+  } else if (FLAGS_eval != "brm") {
+    std::cerr << "unknown eval backend " << FLAGS_eval << "\n";
+    exit(1);
+  }
+}
+
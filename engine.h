@@ -0,0 +1,264 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <gflags/gflags.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "evaluate.h"
+#include "movegen.h"
+#include "position.h"
+#include "stats.h"
+
+#define BETA (1 << 13)
+#define ALPHA (-BETA)
+#define START_POS "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -"
+
+DECLARE_bool(cache);
+DECLARE_bool(killers);
+DECLARE_int64(cache_size);
+DECLARE_bool(idfs);
+DECLARE_int32(order_buckets);
+DECLARE_bool(print_depth);
+DECLARE_bool(print_eval);
+DECLARE_int32(depth);
+DECLARE_string(eval);
+DECLARE_string(eval_file);
+DECLARE_bool(print_stats);
+
+// sets up the stockfish tables and the --eval backend
+void init();
+
+// returns 0 on equal value
+int normalized_eval(const Position &p);
+
+// Evaluator policies passed to the search.  Each scores a position in
+// centipawns from the side to move's point of view.  enter() is called on
+// every interior node before its children are searched.
+struct BrmEval {
+  static inline int evaluate(const Position &p) { return normalized_eval(p); }
+  static inline void enter(const Position &) {}
+};
+
+// Stockfish scores are in internal units (PawnValueEg per pawn), keep them
+// well clear of the mate scores used by negamax
+inline int stockfish_cp(Value v) {
+  return std::clamp(int(v) * 100 / PawnValueEg, ALPHA / 2, BETA / 2);
+}
+
+struct ClassicalEval {
+  static inline int evaluate(const Position &p) {
+    // the classical eval is never called in check by stockfish
+    if (p.checkers()) {
+      Color us = p.side_to_move();
+      return stockfish_cp(p.non_pawn_material(us) - p.non_pawn_material(~us) +
+                          PawnValueMg * (p.count<PAWN>(us) - p.count<PAWN>(~us)));
+    }
+    return stockfish_cp(Eval::evaluate(p));
+  }
+  static inline void enter(const Position &) {}
+};
+
+struct NNUEEval {
+  static inline int evaluate(const Position &p) {
+    return stockfish_cp(Eval::NNUE::evaluate(p));
+  }
+  // keep the accumulator computed along the search path so children only
+  // need a delta update instead of a full refresh
+  static inline void enter(const Position &p) {
+    Eval::NNUE::update_accumulator(p);
+  }
+};
+
+typedef enum { EXACT, UPPERBOUND, LOWERBOUND } entry_flag;
+struct Entry {
+  Entry() = default;
+  int64_t hash;
+  bool valid = 0;
+  int depth;
+  int value;
+  entry_flag flag;
+};
+
+// Transposition table.  Searches sharing one read and write it without
+// locking.  An entry is packed into one word stored next to its key xor that
+// word, both atomic: a probe that reads halves of two different stores (or an
+// entry of another position) fails the key check and is a miss, so a hit is
+// always a whole entry stored for that key.
+class Cache {
+public:
+  explicit Cache(size_t size) : slots_(size) {}
+  Entry lookup(Key hash) const;
+  void set(Key hash, Entry &e);
+  void clear();
+  // permille of the first 1000 entries in use
+  int hashfull() const;
+  size_t size() const { return slots_.size(); }
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> check{0}; // key ^ data
+    std::atomic<uint64_t> data{0};  // packed entry, 0 is empty
+  };
+  std::vector<Slot> slots_;
+};
+
+// the process wide cache, --cache_size entries
+Cache &shared_cache();
+
+// shared_cache() shorthands
+void clear_cache();
+Entry lookup(Key hash);
+Entry lookup(Position &p);
+void set(Key hash, Entry &e);
+void set(Position &p, Entry &e);
+
+// A move list of fixed capacity, so ordering moves does not allocate
+struct Ordered {
+  Ordered() { clear(); }
+  Ordered(const Ordered &o) { *this = o; }
+  Ordered &operator=(const Ordered &o) {
+    memcpy(ordered_, o.ordered_, o.size() * sizeof(Move));
+    last_ = ordered_ + o.size();
+    return *this;
+  }
+  inline const Move *begin() const { return ordered_; }
+  inline const Move *end() const { return last_; }
+  size_t size() const { return (size_t)(last_ - ordered_); }
+  void clear() { last_ = ordered_; }
+  void insert(Move m) {
+    *last_ = m;
+    ++last_;
+  }
+  void insert(const Move *first, const Move *last) {
+    memcpy(last_, first, (last - first) * sizeof(Move));
+    last_ += last - first;
+  }
+
+private:
+  Move ordered_[MAX_MOVES], *last_;
+};
+
+// legal moves, checks first then captures
+Ordered ordered_moves(const Position &p);
+
+typedef enum { BRM_EVAL, CLASSICAL_EVAL, NNUE_EVAL } eval_backend;
+
+// The flags a search reads, copied once so a running search never touches
+// the gflags globals
+struct SearchOptions {
+  bool cache;
+  bool killers;
+  bool idfs;
+  int32_t depth;
+  int32_t order_buckets;
+  bool print_depth;
+  bool print_eval;
+  bool print_stats;
+  eval_backend eval;
+
+  // the command line (init() has to have run for --eval)
+  static SearchOptions from_flags();
+};
+
+// ply -> move
+#define KILLERS 128
+#define KILLERS_PER_PLY 3
+
+// triangular principal variation table, row ply holds the best line found
+// from that ply on
+struct PrincipalVariation {
+  Move moves[MAX_PLY + 2][MAX_PLY + 2];
+  int length[MAX_PLY + 2];
+  int seldepth;
+};
+
+// Everything a search mutates besides the cache, so any number of searches
+// (games) can run at once, each on its own context.  A context is used by one
+// search at a time and keeps its killers from one search to the next, i.e.
+// one per game.  stop and ponder may be set from any thread.
+//
+// The classical eval also uses the stockfish Thread the Position was set
+// with (pawn and material tables), concurrent searches need distinct ones.
+struct SearchContext {
+  explicit SearchContext(Cache *cache = &shared_cache(),
+                         const SearchOptions &options =
+                             SearchOptions::from_flags());
+
+  Cache *cache; // not owned, usually shared_cache()
+  SearchOptions options;
+  // stop unwinds the search, ponder keeps it going past its time limit
+  std::atomic<bool> stop{false};
+  std::atomic<bool> ponder{false};
+  Move killers[KILLERS][KILLERS_PER_PLY];
+  std::unique_ptr<PrincipalVariation> pv;
+  // counters for the last best_move (-DSTATS=ON)
+  SearchStats stats;
+  // states indexed by search ply, reused by every search on the context
+  std::unique_ptr<StateInfo[]> states;
+
+  // forget the killers (new game)
+  void clear();
+};
+
+// the context the best_move overloads without one use, one per thread
+SearchContext &thread_context();
+
+// Per thread stack of states indexed by search ply (thread_context()'s)
+StateInfo *state_stack();
+
+// this thread's counters for the last best_move (-DSTATS=ON)
+SearchStats &search_stats();
+
+// shared_cache().hashfull()
+int hashfull();
+
+// moves to mate for a score (negative when getting mated), 0 if it isn't one
+int mate_moves(int score);
+
+// progress of the search after each completed iteration
+struct SearchInfo {
+  int depth;
+  int seldepth;
+  int score; // side to move, BETA scale: |score| > BETA / 2 is a mate
+  size_t nodes;
+  double time; // seconds since the search started
+  std::vector<Move> pv;
+};
+using InfoCallback = std::function<void(const SearchInfo &)>;
+
+struct SearchLimits {
+  // seconds: no new iteration is started after soft (stretched while the best
+  // move keeps changing), the search is aborted at hard
+  double soft = std::numeric_limits<double>::infinity();
+  double hard = std::numeric_limits<double>::infinity();
+  int32_t depth = -1; // -1 is --depth
+  size_t nodes = 0;   // abort after this many nodes, 0 is unlimited
+  int mate = 0;       // stop once a mate in this many moves is found
+  std::vector<Move> searchmoves; // restrict the root moves
+};
+
+// returns best move and nodes scanned
+template <typename E>
+std::pair<Move, size_t> best_move(SearchContext &ctx, Position &p,
+                                  const SearchLimits &limits,
+                                  const InfoCallback &info = nullptr);
+
+// dispatches to the search instantiated for the context's eval
+std::pair<Move, size_t> best_move(SearchContext &ctx, Position &p,
+                                  const SearchLimits &limits,
+                                  const InfoCallback &info = nullptr);
+
+// on this thread's context
+std::pair<Move, size_t> best_move(Position &p, const SearchLimits &limits,
+                                  const InfoCallback &info = nullptr);
+
+// a fixed time per move
+std::pair<Move, size_t> best_move(Position &p, double max_time,
+                                  int32_t depth = -1,
+                                  const InfoCallback &info = nullptr);
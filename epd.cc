@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "engine.h"
+#include "epd.h"
+#include "movegen.h"
+#include "thread.h"
+#include "uci.h"
+
+namespace {
+
+const char *piece_letters = " PNBRQK";
+
+// standard algebraic notation without check marks
+std::string san(const Position &p, Move m) {
+  const auto from = from_sq(m);
+  const auto to = to_sq(m);
+  if (type_of(m) == CASTLING) {
+    return to > from ? "O-O" : "O-O-O";
+  }
+  const auto pt = type_of(p.moved_piece(m));
+  std::string s;
+  if (pt == PAWN) {
+    if (p.capture(m)) {
+      s += char('a' + file_of(from));
+    }
+  } else {
+    s += piece_letters[pt];
+    // disambiguate between pieces of the same type reaching the same square
+    bool ambiguous = false, same_file = false, same_rank = false;
+    for (const auto &o : MoveList<LEGAL>(p)) {
+      if (o != m && to_sq(o) == to && type_of(p.moved_piece(o)) == pt) {
+        ambiguous = true;
+        same_file |= file_of(from_sq(o)) == file_of(from);
+        same_rank |= rank_of(from_sq(o)) == rank_of(from);
+      }
+    }
+    if (ambiguous && (!same_file || same_rank)) {
+      s += char('a' + file_of(from));
+    }
+    if (same_file) {
+      s += char('1' + rank_of(from));
+    }
+  }
+  if (p.capture(m)) {
+    s += 'x';
+  }
+  s += UCI::square(to);
+  if (type_of(m) == PROMOTION) {
+    s += '=';
+    s += piece_letters[promotion_type(m)];
+  }
+  return s;
+}
+
+// the legal move written as SAN or UCI, MOVE_NONE if there is none
+Move parse_move(const Position &p, std::string token) {
+  token.erase(std::remove_if(token.begin(), token.end(),
+                             [](char c) {
+                               return c == '+' || c == '#' || c == '!' ||
+                                      c == '?';
+                             }),
+              token.end());
+  std::replace(token.begin(), token.end(), '0', 'O');
+  for (const auto &m : MoveList<LEGAL>(p)) {
+    auto s = san(p, m);
+    // promotions are also seen without the '='
+    auto bare = s;
+    bare.erase(std::remove(bare.begin(), bare.end(), '='), bare.end());
+    if (token == s || token == bare || token == UCI::move(m, false)) {
+      return m;
+    }
+  }
+  return MOVE_NONE;
+}
+
+struct Result {
+  Move move = MOVE_NONE;
+  bool solved = false;
+  double time = 0; // when the solution became best for good
+  size_t nodes = 0;
+  size_t total_nodes = 0;
+};
+
+} // namespace
+
+bool parse_epd(const std::string &line, EpdPosition &e) {
+  std::istringstream is(line);
+  std::string token;
+  for (int i = 0; i < 4 && is >> token; ++i) {
+    e.fen += (i ? " " : "") + token;
+  }
+  // full FENs carry the move counters too
+  while (is >> std::ws && std::isdigit(is.peek())) {
+    is >> token;
+    e.fen += " " + token;
+  }
+  Position p;
+  StateInfo si;
+  p.set(e.fen, false, &si, Threads.main());
+
+  std::string ops((std::istreambuf_iterator<char>(is)),
+                  std::istreambuf_iterator<char>());
+  std::istringstream os(ops);
+  for (std::string op; std::getline(os, op, ';');) {
+    std::istringstream o(op);
+    std::string opcode;
+    if (!(o >> opcode)) {
+      continue;
+    }
+    if (opcode == "id") {
+      std::getline(o >> std::ws, e.id);
+      e.id.erase(std::remove(e.id.begin(), e.id.end(), '"'), e.id.end());
+    } else if (opcode == "bm" || opcode == "am") {
+      while (o >> token) {
+        auto m = parse_move(p, token);
+        if (m == MOVE_NONE) {
+          std::cerr << "illegal " << opcode << " " << token << " in: " << line
+                    << "\n";
+          return false;
+        }
+        (opcode == "bm" ? e.bm : e.am).emplace_back(UCI::move(m, false));
+      }
+    }
+  }
+  if (e.bm.empty() && e.am.empty()) {
+    std::cerr << "no bm or am in: " << line << "\n";
+    return false;
+  }
+  return true;
+}
+
+int epd(const std::string &path, int threads, double max_time) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "cannot open " << path << "\n";
+    return 0;
+  }
+  std::vector<EpdPosition> positions;
+  for (std::string line; std::getline(in, line);) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') {
+      continue;
+    }
+    EpdPosition e;
+    if (parse_epd(line, e)) {
+      if (e.id.empty()) {
+        e.id = std::to_string(positions.size() + 1);
+      }
+      positions.emplace_back(e);
+    }
+  }
+
+  threads = std::max(threads, 1);
+  Threads.set(threads);
+  std::vector<Result> results(positions.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&](Thread *th) {
+    for (size_t i; (i = next++) < positions.size();) {
+      const auto &e = positions[i];
+      auto &r = results[i];
+      auto correct = [&](Move m) {
+        const auto uci = UCI::move(m, false);
+        return (e.bm.empty() ||
+                std::find(e.bm.begin(), e.bm.end(), uci) != e.bm.end()) &&
+               std::find(e.am.begin(), e.am.end(), uci) == e.am.end();
+      };
+      Position p;
+      StateListPtr states(new std::deque<StateInfo>(1));
+      p.set(e.fen, false, &states->back(), th);
+      // restart the clock whenever an iteration prefers a wrong move
+      bool best = false;
+      auto info = [&](const SearchInfo &s) {
+        if (s.pv.empty() || !correct(s.pv[0])) {
+          best = false;
+        } else if (!best) {
+          best = true;
+          r.time = s.time;
+          r.nodes = s.nodes;
+        }
+      };
+      std::tie(r.move, r.total_nodes) = best_move(p, max_time, -1, info);
+      r.solved = r.move != MOVE_NONE && best && correct(r.move);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (auto t = 0; t < threads; ++t) {
+    workers.emplace_back(worker, Threads[t]);
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  int solved = 0;
+  double solution_time = 0;
+  size_t solution_nodes = 0;
+  for (size_t i = 0; i < positions.size(); ++i) {
+    const auto &e = positions[i];
+    const auto &r = results[i];
+    std::cout << e.id << ": " << (r.solved ? "solved" : "failed") << " "
+              << UCI::move(r.move, false);
+    for (const auto &m : e.bm) {
+      std::cout << " bm " << m;
+    }
+    for (const auto &m : e.am) {
+      std::cout << " am " << m;
+    }
+    if (r.solved) {
+      std::cout << " time " << size_t(r.time * 1000) << " nodes " << r.nodes;
+      solved++;
+      solution_time += r.time;
+      solution_nodes += r.nodes;
+    }
+    std::cout << "\n";
+  }
+  // unsolved positions count the full search time
+  const auto penalty = (positions.size() - solved) * max_time;
+  std::cout << "\n==========================="
+            << "\nSolved          : " << solved << "/" << positions.size()
+            << "\nSolution time   : " << size_t(solution_time * 1000)
+            << " ms (" << size_t((solution_time + penalty) * 1000)
+            << " ms counting failures as " << max_time << "s)"
+            << "\nSolution nodes  : " << solution_nodes
+            << "\nTotal time (ms) : " << size_t(elapsed.count() * 1000)
+            << std::endl;
+  return solved;
+}
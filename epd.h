@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A test position from an EPD file, bm/am are the best and avoid moves in
+// UCI notation
+struct EpdPosition {
+  std::string id;
+  std::string fen;
+  std::vector<std::string> bm;
+  std::vector<std::string> am;
+};
+
+// parses one EPD record, bm/am may be given in SAN or UCI notation.  Returns
+// false (with a message on stderr) if the line is not a valid record.
+bool parse_epd(const std::string &line, EpdPosition &e);
+
+// Searches every position of path for max_time seconds, spread over threads,
+// and prints when the solution first became the best move and stayed there
+// (time and nodes), solved/total and the total time to solution.  Returns the
+// number of positions solved.
+int epd(const std::string &path, int threads, double max_time);
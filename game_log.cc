@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <fstream>
+
+#include "game_log.h"
+#include "percentile.h"
+
+void GameLog::write_json(const std::string &path,
+                         const std::string &result) const {
+  // latency and overshoot are only meaningful for moves with a time limit
+  std::vector<double> times;
+  size_t untimed = 0;
+  size_t nodes = 0;
+  size_t overshoots = 0;
+  double max_overshoot = 0;
+  int min_depth = moves_.empty() ? 0 : moves_.front().depth;
+  int max_depth = 0;
+  double total_time = 0;
+  for (const auto &m : moves_) {
+    nodes += m.nodes;
+    total_time += m.time;
+    min_depth = std::min(min_depth, m.depth);
+    max_depth = std::max(max_depth, m.depth);
+    if (m.allotted <= 0) {
+      untimed++;
+      continue;
+    }
+    times.emplace_back(m.time);
+    if (m.time > m.allotted) {
+      overshoots++;
+      max_overshoot = std::max(max_overshoot, m.time - m.allotted);
+    }
+  }
+  std::sort(times.begin(), times.end());
+
+  std::ofstream out(path, std::ios::app);
+  out << "{\"result\": \"" << result << "\", \"moves\": " << moves_.size()
+      << ", \"untimed\": " << untimed
+      << ", \"nodes\": " << nodes << ", \"time\": " << total_time
+      << ", \"nps\": " << (total_time > 0 ? size_t(nodes / total_time) : 0)
+      << ", \"latency\": {\"p50\": " << percentile(times, 50)
+      << ", \"p90\": " << percentile(times, 90)
+      << ", \"p99\": " << percentile(times, 99)
+      << ", \"max\": " << (times.empty() ? 0 : times.back())
+      << "}, \"depth\": {\"min\": " << min_depth << ", \"max\": " << max_depth
+      << "}, \"overshoot\": {\"moves\": " << overshoots
+      << ", \"max\": " << max_overshoot << "}, \"series\": [";
+  for (size_t i = 0; i < moves_.size(); ++i) {
+    const auto &m = moves_[i];
+    out << (i ? ", " : "") << "{\"time\": " << m.time << ", \"allotted\": ";
+    if (m.allotted > 0) {
+      out << m.allotted;
+    } else {
+      out << "null, \"untimed\": true";
+    }
+    out << ", \"depth\": " << m.depth
+        << ", \"nodes\": " << m.nodes << ", \"nps\": "
+        << (m.time > 0 ? size_t(m.nodes / m.time) : 0) << "}";
+  }
+  out << "]}\n";
+}
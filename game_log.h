@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Per move timings of the engine over one game, summarized as JSON at the
+// end so latency percentiles and time forfeits can be tracked.
+class GameLog {
+public:
+  struct Move {
+    double time;     // seconds from go to bestmove
+    double allotted; // seconds the search was given, 0 if untimed
+    int depth;       // last completed iteration
+    size_t nodes;
+  };
+
+  void add(const Move &m) { moves_.emplace_back(m); }
+  bool empty() const { return moves_.empty(); }
+  void clear() { moves_.clear(); }
+
+  // one line JSON object with the summary and the per move series, appended
+  // to path
+  void write_json(const std::string &path, const std::string &result) const;
+
+private:
+  std::vector<Move> moves_;
+};
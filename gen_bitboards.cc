@@ -0,0 +1,70 @@
+#include <fstream>
+#include <iostream>
+
+#include "bitboard.h"
+
+// Runs Bitboards::init() and writes the tables it computed as C++ source,
+// which the stockfish library is built with (-DBITBOARD_TABLES) so startup
+// has nothing left to compute.  The attack tables are rebuilt from the
+// magics: every square's attacks start where the previous square's end.
+
+namespace {
+
+template <typename T>
+void write_array(std::ostream &os, const char *decl, const T *values,
+                 size_t n) {
+  os << decl << " = {";
+  for (size_t i = 0; i < n; ++i) {
+    os << (i % 8 ? " " : "\n  ") << uint64_t(values[i])
+       << (sizeof(T) == 8 ? "ULL," : ",");
+  }
+  os << "\n};\n\n";
+}
+
+// the table and the magics pointing into it
+void write_magics(std::ostream &os, const char *table, const char *magics,
+                  const Magic *m) {
+  const auto size = [](const Magic &m) {
+    return size_t(1) << popcount(m.mask);
+  };
+  const auto last = m[SQ_H8].attacks + size(m[SQ_H8]) - m[SQ_A1].attacks;
+  os << "namespace {\n\n";
+  write_array(os, (std::string("Bitboard ") + table + "[" +
+                   std::to_string(last) + "]")
+                      .c_str(),
+              m[SQ_A1].attacks, last);
+  os << "}\n\n";
+  os << "Magic " << magics << "[SQUARE_NB] = {\n";
+  for (Square s = SQ_A1; s <= SQ_H8; ++s) {
+    os << "  {" << m[s].mask << "ULL, " << m[s].magic << "ULL, " << table
+       << " + " << (m[s].attacks - m[SQ_A1].attacks) << ", " << m[s].shift
+       << "},\n";
+  }
+  os << "};\n\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "usage: " << argv[0] << " out.cpp\n";
+    return 1;
+  }
+  Bitboards::init();
+  std::ofstream os(argv[1]);
+  os << "// Generated by gen_bitboards from Bitboards::init(), do not edit\n\n"
+     << "#include \"bitboard.h\"\n\n";
+  write_array(os, "uint8_t PopCnt16[1 << 16]", PopCnt16, 1 << 16);
+  write_array(os, "uint8_t SquareDistance[SQUARE_NB][SQUARE_NB]",
+              &SquareDistance[0][0], SQUARE_NB * SQUARE_NB);
+  write_array(os, "Bitboard SquareBB[SQUARE_NB]", SquareBB, SQUARE_NB);
+  write_array(os, "Bitboard LineBB[SQUARE_NB][SQUARE_NB]", &LineBB[0][0],
+              SQUARE_NB * SQUARE_NB);
+  write_array(os, "Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB]",
+              &PseudoAttacks[0][0], size_t(PIECE_TYPE_NB) * SQUARE_NB);
+  write_array(os, "Bitboard PawnAttacks[COLOR_NB][SQUARE_NB]",
+              &PawnAttacks[0][0], size_t(COLOR_NB) * SQUARE_NB);
+  write_magics(os, "RookTable", "RookMagics", RookMagics);
+  write_magics(os, "BishopTable", "BishopMagics", BishopMagics);
+  return os ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <gflags/gflags.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <netdb.h>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "percentile.h"
+
+DEFINE_string(engine, "./brmbot", "Engine binary to spawn, one per client");
+DEFINE_string(engine_args, "", "Extra arguments for every spawned engine");
+DEFINE_string(connect, "",
+              "Connect to a --serve server at [host:]port or a Unix socket "
+              "path instead of spawning engines");
+DEFINE_int32(clients, 8, "Concurrent clients (games)");
+DEFINE_double(duration, 10, "Seconds to run, games in progress are cut off");
+DEFINE_string(tc, "10+0.1", "Time control per game: seconds+increment");
+DEFINE_int32(max_plies, 120, "Plies after which a game is restarted");
+DEFINE_string(json, "", "Write the results as JSON to this file");
+
+// Simulates clients playing games against brmbot: every client plays both
+// sides of a game from the start position, sending position/go with the
+// clocks of the time control, and charges each move's latency to the clock
+// of the side that made it.  Throughput, move latency and time forfeits are
+// reported at the end.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// A UCI engine at the other end of a pair of descriptors
+class Engine {
+public:
+  Engine(int in, int out, pid_t pid) : in_(in), out_(out), pid_(pid) {}
+  ~Engine() {
+    close(out_);
+    if (in_ != out_) {
+      close(in_);
+    }
+    if (pid_ > 0) {
+      kill(pid_, SIGKILL);
+      waitpid(pid_, nullptr, 0);
+    }
+  }
+
+  bool send(const std::string &line) {
+    const auto s = line + "\n";
+    size_t sent = 0;
+    while (sent < s.size()) {
+      const auto n = write(out_, s.data() + sent, s.size() - sent);
+      if (n <= 0) {
+        return false;
+      }
+      sent += n;
+    }
+    return true;
+  }
+
+  // the next line, false on EOF, an error or timeout
+  bool read_line(std::string &line, const Clock::time_point &deadline) {
+    while (true) {
+      const auto eol = buf_.find('\n');
+      if (eol != std::string::npos) {
+        line = buf_.substr(0, eol);
+        buf_.erase(0, eol + 1);
+        return true;
+      }
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - Clock::now());
+      pollfd pfd = {in_, POLLIN, 0};
+      if (left.count() <= 0 || poll(&pfd, 1, left.count()) <= 0) {
+        return false;
+      }
+      char chunk[4096];
+      const auto n = read(in_, chunk, sizeof(chunk));
+      if (n <= 0) {
+        return false;
+      }
+      buf_.append(chunk, n);
+    }
+  }
+
+  // skips lines up to the first starting with prefix
+  bool wait_for(const std::string &prefix, std::string &line,
+                const Clock::time_point &deadline) {
+    while (read_line(line, deadline)) {
+      if (line.compare(0, prefix.size(), prefix) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  int in_, out_;
+  pid_t pid_;
+  std::string buf_;
+};
+
+std::unique_ptr<Engine> spawn(const std::string &path,
+                              const std::string &args) {
+  int to_engine[2], from_engine[2];
+  if (pipe(to_engine) < 0 || pipe(from_engine) < 0) {
+    return nullptr;
+  }
+  const pid_t pid = fork();
+  if (pid == 0) {
+    dup2(to_engine[0], 0);
+    dup2(from_engine[1], 1);
+    const int null = open("/dev/null", O_WRONLY);
+    dup2(null, 2);
+    for (int fd : {to_engine[0], to_engine[1], from_engine[0], from_engine[1],
+                   null}) {
+      close(fd);
+    }
+    std::vector<std::string> argv_s = {path, "--debug_uci=false"};
+    std::istringstream is(args);
+    for (std::string arg; is >> arg;) {
+      argv_s.emplace_back(arg);
+    }
+    std::vector<char *> argv;
+    for (auto &a : argv_s) {
+      argv.emplace_back(a.data());
+    }
+    argv.emplace_back(nullptr);
+    execv(path.c_str(), argv.data());
+    _exit(127);
+  }
+  close(to_engine[0]);
+  close(from_engine[1]);
+  if (pid < 0) {
+    close(to_engine[1]);
+    close(from_engine[0]);
+    return nullptr;
+  }
+  return std::make_unique<Engine>(from_engine[0], to_engine[1], pid);
+}
+
+std::unique_ptr<Engine> connect_to(const std::string &address) {
+  int fd = -1;
+  if (address.find('/') != std::string::npos) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+      close(fd);
+      fd = -1;
+    }
+  } else {
+    const auto colon = address.rfind(':');
+    const auto host = colon == std::string::npos ? std::string("localhost")
+                                                 : address.substr(0, colon);
+    const auto port =
+        colon == std::string::npos ? address : address.substr(colon + 1);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) {
+      return nullptr;
+    }
+    for (auto ai = res; ai && fd < 0; ai = ai->ai_next) {
+      fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+                  ai->ai_protocol);
+      if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    freeaddrinfo(res);
+  }
+  return fd < 0 ? nullptr : std::make_unique<Engine>(fd, fd, 0);
+}
+
+struct Totals {
+  std::mutex mutex;
+  std::vector<double> latencies; // seconds from go to bestmove
+  size_t games = 0; // played to mate or stalemate
+  size_t cut_off = 0; // stopped by --max_plies or the end of the run
+  size_t forfeits = 0;
+  size_t errors = 0; // engines that died, hung or couldn't be reached
+};
+
+// plays games until the deadline
+void client(Totals &totals, double base, double inc,
+            const Clock::time_point &deadline) {
+  auto e = FLAGS_connect.size() ? connect_to(FLAGS_connect)
+                                : spawn(FLAGS_engine, FLAGS_engine_args);
+  std::string line;
+  const auto handshake = Clock::now() + std::chrono::seconds(10);
+  if (!e || !e->send("uci") || !e->wait_for("uciok", line, handshake) ||
+      !e->send("isready") || !e->wait_for("readyok", line, handshake)) {
+    std::lock_guard<std::mutex> lock(totals.mutex);
+    totals.errors++;
+    return;
+  }
+  std::vector<double> latencies;
+  size_t games = 0, cut_off = 0, forfeits = 0;
+  bool error = false;
+  while (!error && Clock::now() < deadline) {
+    e->send("ucinewgame");
+    double clock[2] = {base, base};
+    std::string moves;
+    bool over = false, forfeit = false;
+    for (auto ply = 0; ply < FLAGS_max_plies && Clock::now() < deadline;
+         ++ply) {
+      const int side = ply % 2;
+      std::ostringstream go;
+      go << "go wtime " << int(clock[0] * 1000) << " btime "
+         << int(clock[1] * 1000) << " winc " << int(inc * 1000) << " binc "
+         << int(inc * 1000);
+      const auto start = Clock::now();
+      // well past the flag the engine is considered hung
+      const auto limit = start + std::chrono::duration_cast<Clock::duration>(
+                                     std::chrono::duration<double>(
+                                         clock[side] + 5));
+      if (!e->send("position startpos" + (moves.size() ? " moves" + moves
+                                                        : std::string())) ||
+          !e->send(go.str()) || !e->wait_for("bestmove", line, limit)) {
+        error = true;
+        break;
+      }
+      std::chrono::duration<double> elapsed = Clock::now() - start;
+      latencies.emplace_back(elapsed.count());
+      clock[side] -= elapsed.count();
+      if (clock[side] < 0) {
+        forfeit = true;
+        break;
+      }
+      clock[side] += inc;
+      std::istringstream is(line);
+      std::string token, move;
+      is >> token >> move;
+      if (move.empty() || move == "(none)" || move == "0000") {
+        over = true; // mate or stalemate
+        break;
+      }
+      moves += " " + move;
+    }
+    if (!error) {
+      games += over;
+      forfeits += forfeit;
+      cut_off += !over && !forfeit;
+    }
+  }
+  std::lock_guard<std::mutex> lock(totals.mutex);
+  totals.latencies.insert(totals.latencies.end(), latencies.begin(),
+                          latencies.end());
+  totals.games += games;
+  totals.cut_off += cut_off;
+  totals.forfeits += forfeits;
+  totals.errors += error;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  // an engine dying mid write must not take the generator down
+  signal(SIGPIPE, SIG_IGN);
+  char *plus;
+  const double base = strtod(FLAGS_tc.c_str(), &plus);
+  const double inc = *plus == '+' ? strtod(plus + 1, nullptr) : 0;
+
+  Totals totals;
+  const auto start = Clock::now();
+  const auto deadline =
+      start + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(FLAGS_duration));
+  std::vector<std::thread> clients;
+  for (auto i = 0; i < FLAGS_clients; ++i) {
+    clients.emplace_back(client, std::ref(totals), base, inc,
+                         std::cref(deadline));
+  }
+  for (auto &c : clients) {
+    c.join();
+  }
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+
+  auto &l = totals.latencies;
+  std::sort(l.begin(), l.end());
+  const double mps = l.size() / elapsed.count();
+  std::cout << "Clients         : " << FLAGS_clients
+            << "\nTime control    : " << base << "+" << inc
+            << "\nTotal time (s)  : " << elapsed.count()
+            << "\nGames           : " << totals.games << " finished, "
+            << totals.cut_off << " cut off"
+            << "\nMoves           : " << l.size()
+            << "\nMoves/second    : " << mps << std::fixed
+            << std::setprecision(1)
+            << "\nLatency (ms)    : p50 " << percentile(l, 50) * 1000 << " p90 "
+            << percentile(l, 90) * 1000 << " p99 " << percentile(l, 99) * 1000
+            << " max " << (l.empty() ? 0 : l.back() * 1000)
+            << "\nTime forfeits   : " << totals.forfeits
+            << "\nErrors          : " << totals.errors << std::endl;
+
+  if (FLAGS_json.size()) {
+    std::ofstream out(FLAGS_json);
+    out << "{\"clients\": " << FLAGS_clients << ", \"tc\": \"" << FLAGS_tc
+        << "\", \"time\": " << elapsed.count()
+        << ", \"games\": " << totals.games
+        << ", \"cut_off\": " << totals.cut_off << ", \"moves\": " << l.size()
+        << ", \"moves_per_second\": " << mps
+        << ", \"latency\": {\"p50\": " << percentile(l, 50)
+        << ", \"p90\": " << percentile(l, 90)
+        << ", \"p99\": " << percentile(l, 99)
+        << ", \"max\": " << (l.empty() ? 0 : l.back())
+        << "}, \"forfeits\": " << totals.forfeits
+        << ", \"errors\": " << totals.errors << "}\n";
+  }
+  return totals.errors ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <gflags/gflags.h>
+#include <iomanip>
+#include <iostream>
+
+#include "bench.h"
+#include "engine.h"
+#include "movegen.h"
+#include "thread.h"
+
+DEFINE_int32(samples, 10, "Timed samples per benchmark");
+DEFINE_int32(iterations, 100, "Passes over the corpus per sample");
+DEFINE_string(json, "", "Write the results as JSON to this file");
+
+// Times the hot paths brmbot depends on over the bench positions.  Every
+// benchmark is sampled a number of times, each sample making a fixed number
+// of passes over the corpus; ns/op is reported with its spread over samples.
+
+struct Result {
+  std::string name;
+  size_t ops;
+  double mean, stddev, min;
+};
+
+static volatile size_t g_sink;
+
+// keeps a result alive so the work producing it isn't optimized away
+static void sink(size_t x) { g_sink = g_sink + x; }
+
+// fn does one pass over the corpus and returns the number of ops it did
+Result run(const std::string &name, const std::function<size_t()> &fn) {
+  std::vector<double> ns;
+  size_t ops = 0;
+  fn(); // warm up
+  for (auto s = 0; s < FLAGS_samples; ++s) {
+    size_t n = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < FLAGS_iterations; ++i) {
+      n += fn();
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    ns.emplace_back(elapsed.count() / n);
+    ops = n;
+  }
+  double mean = 0;
+  for (auto v : ns) {
+    mean += v / ns.size();
+  }
+  double var = 0;
+  for (auto v : ns) {
+    var += (v - mean) * (v - mean) / std::max<size_t>(ns.size() - 1, 1);
+  }
+  Result r{name, ops, mean, std::sqrt(var),
+           *std::min_element(ns.begin(), ns.end())};
+  std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << r.mean << " ns/op  +- "
+            << std::setw(7) << r.stddev << "  min " << std::setw(8) << r.min
+            << "  (" << ops << " ops/sample)\n";
+  return r;
+}
+
+void write_json(const std::string &path, const std::vector<Result> &results,
+                size_t positions) {
+  std::ofstream out(path);
+  out << "{\n  \"positions\": " << positions
+      << ",\n  \"samples\": " << FLAGS_samples
+      << ",\n  \"iterations\": " << FLAGS_iterations
+      << ",\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.ops
+        << ", \"ns_per_op\": " << r.mean << ", \"stddev\": " << r.stddev
+        << ", \"min\": " << r.min << "}" << (i + 1 < results.size() ? "," : "")
+        << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+
+  const auto corpus = bench_positions();
+  std::vector<std::unique_ptr<Position>> positions;
+  std::vector<StateListPtr> histories(corpus.size());
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    positions.emplace_back(new Position);
+    setup(*positions.back(), histories[i], corpus[i], Threads.main());
+  }
+
+  // legal moves are generated up front so per move benchmarks time only
+  // the operation itself
+  std::vector<std::vector<Move>> legal;
+  for (auto &p : positions) {
+    legal.emplace_back();
+    for (const auto &m : MoveList<LEGAL>(*p)) {
+      legal.back().emplace_back(m);
+    }
+  }
+
+  // keys two plies deep, so cache probes are spread over the whole table
+  std::vector<Key> keys;
+  for (auto &p : positions) {
+    StateInfo s0;
+    for (const auto &m : MoveList<LEGAL>(*p)) {
+      p->do_move(m, s0);
+      for (const auto &r : MoveList<LEGAL>(*p)) {
+        keys.emplace_back(p->key_after(r));
+      }
+      p->undo_move(m);
+    }
+  }
+  shared_cache();
+
+  std::vector<Result> results;
+  results.emplace_back(run("movegen", [&] {
+    size_t n = 0;
+    for (auto &p : positions) {
+      sink(MoveList<LEGAL>(*p).size());
+      ++n;
+    }
+    return n;
+  }));
+  results.emplace_back(run("do_undo_move", [&] {
+    size_t n = 0;
+    StateInfo *ss = state_stack();
+    for (size_t i = 0; i < positions.size(); ++i) {
+      auto &p = positions[i];
+      for (const auto &m : legal[i]) {
+        p->do_move(m, *ss);
+        p->undo_move(m);
+        ++n;
+      }
+    }
+    return n;
+  }));
+  results.emplace_back(run("gives_check", [&] {
+    size_t n = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+      auto &p = positions[i];
+      for (const auto &m : legal[i]) {
+        sink(p->gives_check(m));
+        ++n;
+      }
+    }
+    return n;
+  }));
+  results.emplace_back(run("normalized_eval", [&] {
+    for (auto &p : positions) {
+      sink(normalized_eval(*p));
+    }
+    return positions.size();
+  }));
+  results.emplace_back(run("ordered_moves", [&] {
+    for (auto &p : positions) {
+      sink(ordered_moves(*p).size());
+    }
+    return positions.size();
+  }));
+
+  results.emplace_back(run("cache_set", [&] {
+    Entry e{};
+    for (auto k : keys) {
+      e.depth = int(k & 7);
+      set(k, e);
+    }
+    return keys.size();
+  }));
+  results.emplace_back(run("cache_lookup", [&] {
+    for (auto k : keys) {
+      sink(lookup(k).valid);
+    }
+    return keys.size();
+  }));
+
+  if (FLAGS_json.size()) {
+    write_json(FLAGS_json, results, positions.size());
+  }
+  return 0;
+}
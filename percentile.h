@@ -0,0 +1,13 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// nearest rank percentile (p in 0..100) of sorted values, 0 if there are none
+inline double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = std::max<size_t>(1, size_t(p / 100 * sorted.size() + 0.5));
+  return sorted[std::min(rank, sorted.size()) - 1];
+}
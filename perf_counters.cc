@@ -0,0 +1,124 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include "perf_counters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+struct EventConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr uint64_t cache_miss(uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr EventConfig configs[PerfCounters::EVENT_NB] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int open_event(const EventConfig &c) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = c.type;
+  attr.config = c.config;
+  attr.disabled = 1;
+  // user space only, allowed with the default perf_event_paranoid of 2
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+  for (int e = 0; e < EVENT_NB; ++e) {
+    fds_[e] = open_event(configs[e]);
+    if (fds_[e] < 0) {
+      std::cerr << "perf_event_open(" << name(Event(e))
+                << "): " << strerror(errno) << "\n";
+    }
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (auto fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+void PerfCounters::start() {
+  for (auto fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+PerfCounters::Values PerfCounters::stop() {
+  Values values;
+  for (int e = 0; e < EVENT_NB; ++e) {
+    values[e] = -1;
+    if (fds_[e] < 0) {
+      continue;
+    }
+    ioctl(fds_[e], PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t data[3]; // value, time enabled, time running
+    if (read(fds_[e], data, sizeof(data)) != sizeof(data)) {
+      continue;
+    }
+    // the PMU may have been shared with other events, extrapolate
+    values[e] = data[2] ? double(data[0]) * data[1] / data[2] : 0;
+  }
+  return values;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+  fds_.fill(-1);
+  std::cerr << "hardware counters need Linux perf_event_open\n";
+}
+PerfCounters::~PerfCounters() {}
+void PerfCounters::start() {}
+PerfCounters::Values PerfCounters::stop() {
+  Values values;
+  values.fill(-1);
+  return values;
+}
+
+#endif
+
+bool PerfCounters::available() const {
+  for (auto fd : fds_) {
+    if (fd >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *PerfCounters::name(Event e) {
+  static const char *names[EVENT_NB] = {"cycles", "instructions", "l1d_misses",
+                                        "llc_misses", "branch_misses"};
+  return names[e];
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Hardware performance counters of the calling thread, read through Linux
+// perf_event_open.  Events the kernel or the PMU refuse are reported as
+// unavailable instead of failing the run.
+class PerfCounters {
+public:
+  enum Event {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    EVENT_NB
+  };
+  // counts scaled for multiplexing, negative when the event is unavailable
+  using Values = std::array<double, EVENT_NB>;
+
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool available() const;
+  void start();
+  Values stop();
+
+  static const char *name(Event e);
+
+private:
+  std::array<int, EVENT_NB> fds_;
+};
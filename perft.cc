@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "engine.h"
+#include "movegen.h"
+#include "perft.h"
+#include "thread.h"
+#include "uci.h"
+
+namespace {
+
+// Lockless perft hash shared by all threads.  The check word holds the key
+// xor'd with the count, so an entry torn by a concurrent store fails the
+// probe instead of returning a wrong count.
+class PerftTable {
+public:
+  explicit PerftTable(size_t mb)
+      : size_((mb << 20) / sizeof(Entry)), table_(new Entry[size_]()) {}
+
+  bool probe(Key key, int depth, uint64_t &count) const {
+    if (!size_) {
+      return false;
+    }
+    key = mix(key, depth);
+    const auto &e = table_[key % size_];
+    count = e.count.load(std::memory_order_relaxed);
+    return (e.check.load(std::memory_order_relaxed) ^ count) == key;
+  }
+
+  void store(Key key, int depth, uint64_t count) {
+    if (!size_) {
+      return;
+    }
+    key = mix(key, depth);
+    auto &e = table_[key % size_];
+    e.check.store(key ^ count, std::memory_order_relaxed);
+    e.count.store(count, std::memory_order_relaxed);
+  }
+
+private:
+  struct Entry {
+    std::atomic<uint64_t> check, count;
+  };
+
+  // the same position at a different remaining depth is a different entry
+  static Key mix(Key key, int depth) {
+    return key ^ (0x9E3779B97F4A7C15ULL * uint64_t(depth));
+  }
+
+  size_t size_;
+  std::unique_ptr<Entry[]> table_;
+};
+
+// leaves are counted in bulk from the move list of their parent
+uint64_t count(Position &p, StateInfo *ss, int depth, PerftTable &tt) {
+  if (depth == 1) {
+    return MoveList<LEGAL>(p).size();
+  }
+  uint64_t nodes;
+  if (tt.probe(p.key(), depth, nodes)) {
+    return nodes;
+  }
+  nodes = 0;
+  for (const auto &m : MoveList<LEGAL>(p)) {
+    p.do_move(m, *ss);
+    nodes += count(p, ss + 1, depth - 1, tt);
+    p.undo_move(m);
+  }
+  tt.store(p.key(), depth, nodes);
+  return nodes;
+}
+
+} // namespace
+
+uint64_t perft(const std::string &fen, int depth, int threads,
+               size_t hash_mb) {
+  depth = std::clamp(depth, 1, MAX_PLY);
+  threads = std::max(threads, 1);
+  // stockfish threads keep do_move's node counter off a shared cache line
+  Threads.set(threads);
+  PerftTable tt(hash_mb);
+
+  Position root;
+  StateInfo st;
+  root.set(fen, false, &st, Threads.main());
+  std::vector<Move> moves;
+  for (const auto &m : MoveList<LEGAL>(root)) {
+    moves.emplace_back(m);
+  }
+  std::vector<uint64_t> counts(moves.size());
+
+  std::atomic<size_t> next{0};
+  auto worker = [&](Thread *th) {
+    Position p;
+    StateInfo si;
+    p.set(fen, false, &si, th);
+    StateInfo *ss = state_stack();
+    for (size_t i; (i = next++) < moves.size();) {
+      p.do_move(moves[i], *ss);
+      counts[i] = depth > 1 ? count(p, ss + 1, depth - 1, tt) : 1;
+      p.undo_move(moves[i]);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (auto t = 0; t < threads; ++t) {
+    workers.emplace_back(worker, Threads[t]);
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < moves.size(); ++i) {
+    std::cout << UCI::move(moves[i], false) << ": " << counts[i] << "\n";
+    total += counts[i];
+  }
+  std::cout << "\nNodes searched: " << total
+            << "\nTime (ms)     : " << size_t(elapsed.count() * 1000)
+            << "\nNodes/second  : "
+            << size_t(total / std::max(elapsed.count(), 1e-9)) << std::endl;
+  return total;
+}
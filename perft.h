@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Counts the leaves of the legal move tree below fen to the given depth and
+// prints the count under each root move (divide).  Root moves are split
+// across threads, which share a perft hash table of hash_mb MB (0 disables
+// it).  Returns the total.
+uint64_t perft(const std::string &fen, int depth, int threads, size_t hash_mb);
@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "engine.h"
+#include "server.h"
+#include "session.h"
+#include "thread.h"
+#include "uci.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// One connection.  The I/O thread owns the socket, the input and the game
+// between searches.  The output, the held bestmove and busy are shared with
+// the worker searching for the session, under mutex.
+struct Session {
+  explicit Session(int fd) : fd(fd), game(Threads.main()) {}
+
+  int fd;
+  std::string in;                   // the last, incomplete line
+  std::deque<std::string> deferred; // lines waiting for the search to end
+  std::string unsent;               // output the socket didn't take yet
+  uint32_t events = EPOLLIN | EPOLLRDHUP; // what epoll watches for
+  bool writable = true;             // false once sending failed
+  bool closing = false;             // quit or EOF, closed once idle
+  UciGame game;
+  SearchContext ctx;
+  // the go being searched, written before it is queued
+  GoCommand go;
+  Clock::time_point received;
+  // scheduling, under the server's queue mutex
+  double used = 0; // seconds searched so far
+  size_t seq = 0;  // when the go was queued
+
+  std::mutex mutex;
+  std::string out;   // lines for the socket
+  std::string held;  // bestmove waiting for stop or ponderhit
+  bool busy = false; // queued or searching
+};
+
+} // namespace
+
+int listen_on(const std::string &address, bool nonblocking) {
+  const int flags = SOCK_CLOEXEC | (nonblocking ? SOCK_NONBLOCK : 0);
+  if (address.find('/') != std::string::npos) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (address.size() >= sizeof(addr.sun_path)) {
+      std::cerr << "socket path too long: " << address << "\n";
+      return -1;
+    }
+    strcpy(addr.sun_path, address.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | flags, 0);
+    unlink(address.c_str());
+    if (fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+      std::cerr << "cannot listen on " << address << ": " << strerror(errno)
+                << "\n";
+      if (fd >= 0) {
+        close(fd);
+      }
+      return -1;
+    }
+    return fd;
+  }
+
+  const auto colon = address.rfind(':');
+  const auto host =
+      colon == std::string::npos ? std::string() : address.substr(0, colon);
+  const auto port =
+      colon == std::string::npos ? address : address.substr(colon + 1);
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  addrinfo *res;
+  if (int err = getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                            port.c_str(), &hints, &res)) {
+    std::cerr << "cannot resolve " << address << ": " << gai_strerror(err)
+              << "\n";
+    return -1;
+  }
+  int fd = -1;
+  for (auto ai = res; ai && fd < 0; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | flags, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, ai->ai_addr, ai->ai_addrlen) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(res);
+  if (fd < 0) {
+    std::cerr << "cannot listen on " << address << ": " << strerror(errno)
+              << "\n";
+  }
+  return fd;
+}
+
+namespace {
+
+class Server {
+public:
+  Server(int listen_fd, int workers, double max_time, int info_interval)
+      : listen_fd_(listen_fd), max_time_(max_time),
+        info_interval_(info_interval) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    watch(listen_fd_, EPOLLIN);
+    watch(wake_fd_, EPOLLIN);
+    // a stockfish Thread per worker for the classical eval's tables
+    Threads.set(workers);
+    for (auto i = 0; i < workers; ++i) {
+      workers_.emplace_back([this, i]() { work(Threads[i]); });
+    }
+  }
+
+  ~Server() {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      exit_ = true;
+    }
+    queue_cv_.notify_all();
+    for (auto &w : workers_) {
+      w.join();
+    }
+    for (auto &s : sessions_) {
+      close(s.first);
+    }
+    close(wake_fd_);
+    close(epoll_fd_);
+  }
+
+  // the I/O loop, returns if epoll fails
+  void run() {
+    epoll_event events[64];
+    while (true) {
+      int timeout = -1;
+      if (accept_paused_until_) {
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(
+            *accept_paused_until_ - std::chrono::steady_clock::now());
+        timeout = std::max<int>(0, left.count());
+      }
+      const int n = epoll_wait(epoll_fd_, events, 64, timeout);
+      if (accept_paused_until_ &&
+          std::chrono::steady_clock::now() >= *accept_paused_until_) {
+        accept_paused_until_.reset();
+        watch(listen_fd_, EPOLLIN);
+      }
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        std::cerr << "epoll_wait: " << strerror(errno) << "\n";
+        return;
+      }
+      for (auto i = 0; i < n; ++i) {
+        const int fd = events[i].data.fd;
+        if (fd == listen_fd_) {
+          accept_all();
+        } else if (fd == wake_fd_) {
+          uint64_t count;
+          while (read(wake_fd_, &count, sizeof(count)) > 0) {
+          }
+        } else if (sessions_.count(fd)) {
+          receive(*sessions_[fd]);
+        }
+      }
+      // workers may have finished searches or queued output for anyone
+      for (auto it = sessions_.begin(); it != sessions_.end();) {
+        auto &s = *it->second;
+        service(s);
+        if (s.closing && !busy(s) && (s.unsent.empty() || !s.writable)) {
+          epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, s.fd, nullptr);
+          close(s.fd);
+          std::cerr << "session " << s.fd << " closed\n";
+          it = sessions_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+private:
+  void watch(int fd, uint32_t events, int op = EPOLL_CTL_ADD) {
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(epoll_fd_, op, fd, &ev);
+  }
+
+  void wake() {
+    const uint64_t one = 1;
+    [[maybe_unused]] auto r = write(wake_fd_, &one, sizeof(one));
+  }
+
+  static bool busy(Session &s) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.busy;
+  }
+
+  static void send(Session &s, const std::string &line) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.out += line + "\n";
+  }
+
+  void accept_all() {
+    while (true) {
+      const int fd =
+          accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          // out of descriptors or memory: the pending connection keeps the
+          // level triggered listen fd readable, so stop watching it for a
+          // while instead of spinning on it
+          std::cerr << "accept: " << strerror(errno) << ", pausing\n";
+          epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, listen_fd_, nullptr);
+          accept_paused_until_ =
+              std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        }
+        return;
+      }
+      int one = 1;
+      // fails harmlessly on Unix sockets
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      sessions_[fd] = std::make_unique<Session>(fd);
+      watch(fd, EPOLLIN | EPOLLRDHUP);
+      std::cerr << "session " << fd << " connected\n";
+    }
+  }
+
+  void receive(Session &s) {
+    char buf[4096];
+    bool eof = false;
+    while (true) {
+      const auto n = recv(s.fd, buf, sizeof(buf), 0);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      }
+      if (n <= 0) {
+        eof = true;
+        break;
+      }
+      s.in.append(buf, n);
+    }
+    size_t start = 0;
+    for (size_t end; (end = s.in.find('\n', start)) != std::string::npos;
+         start = end + 1) {
+      auto line = s.in.substr(start, end - start);
+      if (line.size() && line.back() == '\r') {
+        line.pop_back();
+      }
+      // keep the order once a command had to wait
+      if (!s.closing && (!s.deferred.empty() || !command(s, line))) {
+        s.deferred.emplace_back(line);
+      }
+    }
+    s.in.erase(0, start);
+    if (eof) {
+      // EOF or reset, the same as quit
+      s.closing = true;
+      stop_search(s);
+    }
+  }
+
+  // runs the deferred commands once the search is over and sends the output
+  void service(Session &s) {
+    while (!s.closing && !s.deferred.empty() && command(s, s.deferred.front())) {
+      s.deferred.pop_front();
+    }
+    {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      s.unsent += s.out;
+      s.out.clear();
+    }
+    if (s.unsent.size() && s.writable) {
+      const auto n =
+          ::send(s.fd, s.unsent.data(), s.unsent.size(), MSG_NOSIGNAL);
+      if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        s.writable = false;
+        s.closing = true;
+        stop_search(s);
+      }
+      s.unsent.erase(0, std::max<ssize_t>(n, 0));
+    }
+    // a closing session only waits for room in the socket buffer
+    const uint32_t events =
+        (s.closing ? 0u : uint32_t(EPOLLIN | EPOLLRDHUP)) |
+        (s.unsent.size() && s.writable ? uint32_t(EPOLLOUT) : 0u);
+    if (events != s.events) {
+      s.events = events;
+      watch(s.fd, events, EPOLL_CTL_MOD);
+    }
+  }
+
+  // stop and quit: the search unwinds and a held bestmove goes out
+  void stop_search(Session &s) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.ctx.ponder = false;
+    s.ctx.stop = true;
+    s.out += s.held;
+    s.held.clear();
+  }
+
+  // handles one line, false if it has to wait for the search to end
+  bool command(Session &s, const std::string &line) {
+    std::istringstream is(line);
+    std::string cmd;
+    is >> cmd;
+    if (cmd == "uci") {
+      send(s, "id name brmbot\nid author bwasti\nuciok");
+    } else if (cmd == "isready") {
+      send(s, "readyok");
+    } else if (cmd == "stop") {
+      stop_search(s);
+    } else if (cmd == "ponderhit") {
+      // the search keeps going on its normal time limit
+      std::lock_guard<std::mutex> lock(s.mutex);
+      s.ctx.ponder = false;
+      if (!s.go.infinite) {
+        s.out += s.held;
+        s.held.clear();
+      }
+    } else if (cmd == "quit") {
+      s.closing = true;
+      stop_search(s);
+    } else if (cmd == "position" || cmd == "go" || cmd == "ucinewgame") {
+      stop_search(s);
+      if (busy(s)) {
+        return false;
+      }
+      if (cmd == "position") {
+        s.game.set(is, Threads.main());
+      } else if (cmd == "ucinewgame") {
+        s.ctx.clear();
+      } else {
+        s.go = parse_go(is, s.game.p, max_time_);
+        s.received = Clock::now();
+        s.ctx.stop = false;
+        s.ctx.ponder = s.go.ponder;
+        {
+          std::lock_guard<std::mutex> lock(s.mutex);
+          s.busy = true;
+        }
+        {
+          std::lock_guard<std::mutex> lock(queue_mutex_);
+          s.seq = seq_++;
+          queue_.push_back(&s);
+        }
+        queue_cv_.notify_one();
+      }
+    }
+    // setoption is ignored, the time manager's options are per process
+    return true;
+  }
+
+  void work(Thread *th) {
+    while (true) {
+      Session *s;
+      {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        queue_cv_.wait(lock, [this]() { return exit_ || !queue_.empty(); });
+        if (exit_) {
+          return;
+        }
+        // fair share: the session that has searched least goes first
+        auto it = std::min_element(
+            queue_.begin(), queue_.end(), [](Session *a, Session *b) {
+              return std::tie(a->used, a->seq) < std::tie(b->used, b->seq);
+            });
+        s = *it;
+        queue_.erase(it);
+      }
+      const auto start = Clock::now();
+      search(*s, th);
+      std::chrono::duration<double> elapsed = Clock::now() - start;
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        s->used += elapsed.count();
+      }
+      {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->busy = false;
+      }
+      wake();
+    }
+  }
+
+  void search(Session &s, Thread *th) {
+    auto &p = s.game.p;
+    p.set_thread(th);
+    // the clock started when go arrived, waiting in the queue is charged to
+    // the session
+    auto limits = s.go.limits;
+    std::chrono::duration<double> waited = Clock::now() - s.received;
+    limits.soft = std::max(0.0, limits.soft - waited.count());
+    limits.hard = std::max(0.0, limits.hard - waited.count());
+
+    InfoThrottle info(info_interval_, [&](const SearchInfo &i) {
+      send(s, info_line(i, s.ctx.cache->hashfull()));
+      wake();
+    });
+    const auto m = best_move(s.ctx, p, limits, info.callback()).first;
+    p.set_thread(Threads.main());
+    info.flush();
+    const auto line = bestmove_line(m, info.last().pv) + "\n";
+    std::lock_guard<std::mutex> lock(s.mutex);
+    // a held bestmove goes out with stop or ponderhit, the worker doesn't
+    // wait for it
+    if (hold_bestmove(s.ctx, s.go.infinite)) {
+      s.held = line;
+    } else {
+      s.out += line;
+    }
+  }
+
+  int listen_fd_;
+  int epoll_fd_;
+  int wake_fd_;
+  // set while accepting is backed off after a failure
+  std::optional<std::chrono::steady_clock::time_point> accept_paused_until_;
+  double max_time_;
+  int info_interval_;
+  std::unordered_map<int, std::unique_ptr<Session>> sessions_;
+
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cv_;
+  std::vector<Session *> queue_;
+  size_t seq_ = 0;
+  bool exit_ = false;
+  std::vector<std::thread> workers_;
+};
+
+} // namespace
+
+bool serve(const std::string &address, int workers, double max_time,
+           int info_interval) {
+  const int fd = listen_on(address, true);
+  if (fd < 0) {
+    return false;
+  }
+  std::cerr << "Serving UCI on " << address << " with "
+            << std::max(workers, 1) << " workers...\n";
+  Server server(fd, std::max(workers, 1), max_time, info_interval);
+  server.run();
+  close(fd);
+  return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// A listening socket (close on exec) for "[host:]port" or a Unix socket path,
+// which is unlinked first.  -1 on error, which is reported on stderr.
+int listen_on(const std::string &address, bool nonblocking);
+
+// Serves UCI sessions on address, "[host:]port" for TCP or a path for a Unix
+// socket.  Every connection is its own game (position, killers); go commands
+// from all of them are searched by a pool of workers sharing the cache, the
+// session with the least search time so far first.  Time a go spends queued
+// counts against its limits.  Untimed go commands get max_time seconds and
+// info lines are sent at most every info_interval ms.  Runs until killed,
+// returns false if the socket could not be set up.
+bool serve(const std::string &address, int workers, double max_time,
+           int info_interval);
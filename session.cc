@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <iostream>
+
+#include "misc.h"
+#include "session.h"
+#include "timeman.h"
+#include "uci.h"
+
+SearchLimits clock_limits(Search::LimitsType &clock, const Position &p) {
+  SearchLimits limits;
+  Time.init(clock, p.side_to_move(), p.game_ply());
+  limits.soft = Time.optimum() / 1000.0;
+  limits.hard = Time.maximum() / 1000.0;
+  return limits;
+}
+
+GoCommand parse_go(std::istringstream &is, const Position &p,
+                   double default_time) {
+  Search::LimitsType clock;
+  clock.startTime = now();
+  GoCommand go;
+  auto &limits = go.limits;
+  for (std::string token; is >> token;) {
+    if (token == "wtime") {
+      is >> clock.time[WHITE];
+    } else if (token == "btime") {
+      is >> clock.time[BLACK];
+    } else if (token == "winc") {
+      is >> clock.inc[WHITE];
+    } else if (token == "binc") {
+      is >> clock.inc[BLACK];
+    } else if (token == "movestogo") {
+      is >> clock.movestogo;
+    } else if (token == "movetime") {
+      is >> clock.movetime;
+    } else if (token == "depth") {
+      is >> limits.depth;
+    } else if (token == "nodes") {
+      is >> limits.nodes;
+    } else if (token == "mate") {
+      is >> limits.mate;
+    } else if (token == "searchmoves") {
+      while (is >> token) {
+        const auto m = UCI::to_move(p, token);
+        if (m == MOVE_NONE) {
+          std::cerr << "ERROR illegal move " << token << "\n";
+          continue;
+        }
+        limits.searchmoves.emplace_back(m);
+      }
+    } else if (token == "infinite") {
+      go.infinite = true;
+    } else if (token == "ponder") {
+      go.ponder = true;
+    }
+  }
+  if (clock.movetime) {
+    // the time to send bestmove comes out of movetime too, as it does out of
+    // the clock in clock_limits
+    const auto overhead = TimePoint(Options["Move Overhead"]);
+    limits.soft = limits.hard =
+        std::max<TimePoint>(clock.movetime - overhead, 1) / 1000.0;
+  } else if (clock.use_time_management()) {
+    const auto t = clock_limits(clock, p);
+    limits.soft = t.soft;
+    limits.hard = t.hard;
+  } else if (!go.infinite && limits.depth < 0 && !limits.nodes &&
+             !limits.mate) {
+    // depth, nodes and mate limits alone run untimed
+    limits.soft = limits.hard = default_time;
+  }
+  return go;
+}
+
+std::string uci_score(int score) {
+  // a checkmated root, mate_moves() has no way to say 0
+  if (score <= ALPHA) {
+    return "mate 0";
+  }
+  if (const int mate = mate_moves(score)) {
+    return "mate " + std::to_string(mate);
+  }
+  return "cp " + std::to_string(score);
+}
+
+std::string info_line(const SearchInfo &info, int hashfull) {
+  std::ostringstream ss;
+  ss << "info depth " << info.depth << " seldepth " << info.seldepth
+     << " score " << uci_score(info.score) << " nodes " << info.nodes
+     << " nps " << size_t(info.nodes / std::max(info.time, 1e-3))
+     << " hashfull " << hashfull << " time " << size_t(info.time * 1000);
+  if (info.pv.size()) {
+    ss << " pv";
+  }
+  for (const auto &m : info.pv) {
+    ss << " " << UCI::move(m, false);
+  }
+  return ss.str();
+}
+
+InfoCallback InfoThrottle::callback() {
+  return [this](const SearchInfo &i) {
+    last_ = i;
+    pending_ = i;
+    if ((i.time - printed_) * 1000 >= interval_) {
+      print_(i);
+      printed_ = i.time;
+      pending_.reset();
+    }
+  };
+}
+
+void InfoThrottle::flush() {
+  if (pending_) {
+    print_(*pending_);
+    pending_.reset();
+  }
+}
+
+std::string bestmove_line(Move m, const std::vector<Move> &pv) {
+  auto line = "bestmove " + UCI::move(m, false);
+  if (pv.size() > 1 && pv[0] == m) {
+    line += " ponder " + UCI::move(pv[1], false);
+  }
+  return line;
+}
+
+bool hold_bestmove(const SearchContext &ctx, bool infinite) {
+  return !ctx.stop && (ctx.ponder || infinite);
+}
+
+UciGame::UciGame(Thread *th)
+    : states(new std::deque<StateInfo>(1)), root(START_POS) {
+  p.set(root, false, &states->back(), th);
+}
+
+bool UciGame::set(std::istringstream &is, Thread *th) {
+  std::string token, fen;
+  is >> token;
+  if (token == "startpos") {
+    fen = START_POS;
+    is >> token; // moves
+  } else if (token == "fen") {
+    while (is >> token && token != "moves") {
+      fen += (fen.empty() ? "" : " ") + token;
+    }
+  } else {
+    std::cerr << "ERROR unknown position " << token << "\n";
+    return false;
+  }
+  std::vector<std::string> moves;
+  while (is >> token) {
+    moves.emplace_back(token);
+  }
+  const bool extends = fen == root && moves.size() >= played.size() &&
+                       std::equal(played.begin(), played.end(), moves.begin());
+  if (!extends) {
+    states = StateListPtr(new std::deque<StateInfo>(1));
+    p.set(fen, false, &states->back(), th);
+    root = fen;
+    played.clear();
+  }
+  for (size_t i = played.size(); i < moves.size(); ++i) {
+    const auto m = UCI::to_move(p, moves[i]);
+    if (m == MOVE_NONE) {
+      std::cerr << "ERROR illegal move " << moves[i] << "\n";
+      break;
+    }
+    states->emplace_back();
+    p.do_move(m, states->back());
+    played.emplace_back(moves[i]);
+  }
+  return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+#include "position.h"
+#include "search.h"
+
+// UCI command handling shared by the stdin loop and --serve
+
+// Soft and hard limits for a move from the UCI clock, using stockfish's
+// TimeManagement (move overhead, movestogo, "Slow Mover" and "Ponder" come
+// from its UCI options).  The soft limit is its optimum time, the hard limit
+// its maximum.  TimeManagement is global, call it from one thread only.
+SearchLimits clock_limits(Search::LimitsType &clock, const Position &p);
+
+struct GoCommand {
+  SearchLimits limits;
+  bool infinite = false;
+  bool ponder = false;
+};
+
+// Parses the rest of a go command for the root p.  A go with neither a clock
+// nor a depth, nodes or mate limit gets default_time seconds.
+GoCommand parse_go(std::istringstream &is, const Position &p,
+                   double default_time);
+
+// "cp N" or "mate N"
+std::string uci_score(int score);
+
+// the info line for a completed iteration, without the newline
+std::string info_line(const SearchInfo &info, int hashfull);
+
+// Passes a search's iterations on to print at most once per interval ms:
+// iterations at low depth finish in microseconds.  The one held back last
+// goes out with flush(), before bestmove.
+class InfoThrottle {
+public:
+  InfoThrottle(int interval, std::function<void(const SearchInfo &)> print)
+      : interval_(interval), print_(std::move(print)) {}
+
+  // the InfoCallback for best_move, valid while the throttle lives
+  InfoCallback callback();
+  void flush();
+  // the last iteration reported, depth 0 and no pv before the first
+  const SearchInfo &last() const { return last_; }
+
+private:
+  int interval_;
+  std::function<void(const SearchInfo &)> print_;
+  SearchInfo last_ = {};
+  std::optional<SearchInfo> pending_;
+  double printed_ = -1; // search time of the last line printed
+};
+
+// "bestmove m", with "ponder" and the reply if pv starts with m
+std::string bestmove_line(Move m, const std::vector<Move> &pv);
+
+// bestmove has to wait for stop (go infinite) or ponderhit
+bool hold_bestmove(const SearchContext &ctx, bool infinite);
+
+// The game a session plays: the position command's root and moves, and the
+// states behind the current position (repetitions, NNUE accumulators).
+struct UciGame {
+  explicit UciGame(Thread *th);
+
+  // position [startpos | fen ...] moves ...  When the moves extend the
+  // previous command's only the new ones are played, keeping the history
+  // intact.  Returns false (and keeps the old position) on an unknown
+  // position, stops at an illegal move.
+  bool set(std::istringstream &is, Thread *th);
+
+  Position p;
+  StateListPtr states;
+  std::string root;
+  std::vector<std::string> played;
+};
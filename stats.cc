@@ -0,0 +1,37 @@
+#include <cmath>
+#include <iomanip>
+
+#include "stats.h"
+
+namespace {
+
+double percent(size_t n, size_t d) { return d ? 100.0 * n / d : 0; }
+
+} // namespace
+
+void SearchStats::print(std::ostream &os) const {
+  os << std::fixed << std::setprecision(1);
+  os << "stats:\n";
+  for (size_t d = 0; d < iteration_nodes.size(); ++d) {
+    os << "  depth " << d + 1 << ":\tnodes " << iteration_nodes[d];
+    if (d && iteration_nodes[d - 1]) {
+      os << "\tbranching " << double(iteration_nodes[d]) / iteration_nodes[d - 1];
+    }
+    os << "\n";
+  }
+  // geometric mean of the per iteration growth
+  if (iteration_nodes.size() > 1 && iteration_nodes.front()) {
+    os << "  ebf:\t" << std::pow(double(iteration_nodes.back()) /
+                                     iteration_nodes.front(),
+                                 1.0 / (iteration_nodes.size() - 1))
+       << "\n";
+  }
+  os << "  cache:\tprobes " << cache_probes << "\thits "
+     << percent(cache_hits, cache_probes) << "%\tcutoffs "
+     << percent(cache_cutoffs, cache_probes) << "%\n";
+  os << "  fail high:\t" << fail_highs << "\tfirst move "
+     << percent(first_move_fail_highs, fail_highs) << "%\tkiller "
+     << percent(killer_fail_highs, fail_highs) << "%\n";
+  os << "  nodes:\tinterior " << interior << "\tleaves " << leaves << "\n";
+  os << std::defaultfloat;
+}
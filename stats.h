@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Per search counters for tuning move ordering and the cache.  They are only
+// compiled in with -DSTATS=ON (BRMBOT_STATS), otherwise STAT() expands to
+// nothing and the search carries no counting code.
+#if defined(BRMBOT_STATS)
+#define STAT(...) __VA_ARGS__
+#else
+#define STAT(...)
+#endif
+
+struct SearchStats {
+  std::vector<size_t> iteration_nodes; // nodes searched by each completed iteration
+  size_t cache_probes, cache_hits, cache_cutoffs;
+  size_t fail_highs, first_move_fail_highs, killer_fail_highs;
+  size_t leaves, interior;
+
+  void clear() { *this = SearchStats(); }
+  void print(std::ostream &os) const;
+};
@@ -1,21 +1,15 @@
 #!/bin/bash
 
-function board_test() {
-  build/brmbot --print_eval --uci=false --depth 8 --killers=false --order_buckets=4 --cache=false --max_time=3 --print_time --print_depth --move_limit 1 --fen \""$1"\"
-	echo "should be $2"
-}
-
 cd build; ninja; cd ..
 
-# mate in one
-board_test "1n2k3/2p2pp1/2p2n2/1q6/5K2/3r4/8/8 b - - 7 33" "g7g5"
-# mate in two
-board_test "4kn2/2p2pp1/2p2n2/8/5K2/3r4/8/8 b - - 4 3" "f8e6 or f8g6"
-# up a piece
-board_test "rnbqkb1r/pp1ppppp/2p2n2/4P3/8/8/PPPP1PPP/RNBQKBNR w KQkq - 0 3" "e5f6"
-# puzzle
-board_test "1n2k1n1/2p2pp1/2p5/3r4/8/1p6/5K2/8 b - - 1 28" "b3b2"
-# mate in 4
-board_test "8/4pR2/8/2P5/3P3Q/2K1P3/4q1k1/2B5 w - - 1 44" "c1d2 or f7g7"
-# piece choice
-board_test "r1b1kb1r/ppp2ppp/2n5/4p3/2PqQ3/2N5/PP1P1PPP/R1B1K1NR w KQkq - 3 8" "NOT c3b5"
+# mate in one/two/four, winning a piece, a puzzle and a piece choice
+build/brmbot --epd tactics.epd --threads 4 --depth 8 --killers=false --order_buckets=4 --cache=false --max_time=3
+
+# a checkmated and a stalemated root are reported once, as mate 0 and cp 0
+check_terminal() {
+  printf 'position fen %s\ngo depth 4\n' "$1" | build/brmbot 2>/dev/null |
+    grep -qx "info depth 0 seldepth 0 score $2 nodes 0 nps 0 hashfull 0 time 0" ||
+    { echo "FAILED: $1 should score $2"; exit 1; }
+}
+check_terminal "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3" "mate 0"
+check_terminal "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1" "cp 0"
@@ -0,0 +1,54 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "zygote.h"
+
+bool zygote(const std::string &path, const std::function<void()> &session) {
+  const int fd = listen_on(path, false);
+  if (fd < 0) {
+    return false;
+  }
+  // children are reaped by the kernel
+  signal(SIGCHLD, SIG_IGN);
+  std::cerr << "Zygote listening on " << path << "...\n";
+
+  while (true) {
+    const int conn = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      std::cerr << "accept: " << strerror(errno) << "\n";
+      close(fd);
+      return false;
+    }
+    // nothing buffered may be written twice
+    std::cout.flush();
+    std::cerr.flush();
+    const pid_t pid = fork();
+    if (pid == 0) {
+      signal(SIGCHLD, SIG_DFL);
+      close(fd);
+      dup2(conn, 0);
+      dup2(conn, 1);
+      close(conn);
+      session();
+      std::cout.flush();
+      fflush(stdout);
+      // the parent's exit handlers and destructors are not ours to run
+      _exit(0);
+    }
+    if (pid < 0) {
+      std::cerr << "fork: " << strerror(errno) << "\n";
+    } else {
+      std::cerr << "session " << pid << " forked\n";
+    }
+    close(conn);
+  }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// Listens on path (a Unix socket, or [host:]port as for serve()) and forks a
+// child per connection that runs session with the connection as its stdin
+// and stdout.  Everything set up before the call (tables, the NNUE net, the
+// cache) is inherited copy on write, so a child can answer at once.  Runs
+// until killed, returns false if the socket could not be set up.
+bool zygote(const std::string &path, const std::function<void()> &session);